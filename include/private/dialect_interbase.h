@@ -20,6 +20,7 @@ public:
     virtual const String create_sequence(const String &seq_name);
     virtual const String drop_sequence(const String &seq_name);
     virtual int pager_model();
+    virtual int max_params();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table);
     virtual bool view_exists(SqlConnection &conn, const String &table);
@@ -24,6 +24,9 @@ public:
     virtual const String grant_insert_id_statement(const String &table_name, bool on);
     virtual bool explicit_null();
     virtual int pager_model();
+    virtual int max_params();
+    virtual int insert_model();
+    virtual int returning_model();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table);
     virtual bool view_exists(SqlConnection &conn, const String &table);
@@ -18,6 +18,7 @@ public:
     virtual const String drop_sequence(const String &seq_name);
     virtual const String sysdate_func();
     virtual int pager_model();
+    virtual int insert_model();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table);
     virtual bool view_exists(SqlConnection &conn, const String &table);
@@ -16,6 +16,10 @@ public:
     virtual const String type2sql(int t);
     virtual const String create_sequence(const String &seq_name);
     virtual const String drop_sequence(const String &seq_name);
+    virtual const String autoinc_flag();
+    virtual int max_params();
+    virtual int insert_model();
+    virtual int returning_model();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table);
     virtual bool view_exists(SqlConnection &conn, const String &table);
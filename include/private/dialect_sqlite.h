@@ -22,6 +22,10 @@ public:
     virtual const String drop_sequence(const String &seq_name);
     virtual const String primary_key_flag();
     virtual const String autoinc_flag();
+    virtual int max_params();
+    virtual int insert_model();
+    virtual bool consecutive_insert_ids();
+    virtual int max_insert_rows();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table);
     virtual bool view_exists(SqlConnection &conn, const String &table);
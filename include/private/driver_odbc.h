@@ -9,17 +9,33 @@
 
 namespace Yb {
 
+//! Rows fetched at once, unless the source sets "fetch_rows"
+#define YB_ODBC_FETCH_ROWS 100
+
 class OdbcCursorBackend: public SqlCursorBackend
 {
     tiodbc::connection *conn_;
     std::auto_ptr<tiodbc::statement> stmt_;
+    int fetch_rows_;
+    void set_param(int num, const Value &x);
     void really_exec(const Values &params);
+    void new_stmt();
 public:
-    OdbcCursorBackend(tiodbc::connection *conn);
+    OdbcCursorBackend(tiodbc::connection *conn,
+                      int fetch_rows = YB_ODBC_FETCH_ROWS);
     void exec_direct(const String &sql);
     void prepare(const String &sql);
     void exec(const Values &params);
+    void exec_batch(const std::vector<Values> &params_rows);
     RowPtr fetch_row();
+    bool fetch_values(Values &values, Strings *names);
+    void reset();
+    bool blob_streams();
+    bool read_blob(const String &table, const String &column,
+            const String &where, const Values &params, std::ostream &out);
+    void write_blob(const String &table, const String &column,
+            const String &where, const Values &params,
+            std::istream &in, LongInt size);
 };
 
 class OdbcDriver;
@@ -28,6 +44,7 @@ class OdbcConnectionBackend: public SqlConnectionBackend
 {
     std::auto_ptr<tiodbc::connection> conn_;
     OdbcDriver *drv_;
+    int fetch_rows_;
 public:
     OdbcConnectionBackend(OdbcDriver *drv);
     void open(SqlDialect *dialect, const SqlSource &source);
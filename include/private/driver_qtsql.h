@@ -22,7 +22,11 @@ public:
     void exec_direct(const String &sql);
     void prepare(const String &sql);
     void exec(const Values &params);
+    void exec_batch(const std::vector<Values> &params_rows);
+    bool last_insert_id(LongInt &id);
     RowPtr fetch_row();
+    bool fetch_values(Values &values, Strings *names);
+    void reset();
 };
 
 class QtSqlDriver;
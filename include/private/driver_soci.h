@@ -28,7 +28,10 @@ public:
     void prepare(const String &sql);
     void bind_params(const TypeCodes &types);
     void exec(const Values &params);
+    void exec_batch(const std::vector<Values> &params_rows);
+    bool last_insert_id(LongInt &id);
     RowPtr fetch_row();
+    bool fetch_values(Values &values, Strings *names);
 };
 
 class SOCIDriver;
@@ -18,14 +18,31 @@ class SQLiteCursorBackend: public SqlCursorBackend
     SQLiteDatabase *conn_;
     SQLiteQuery *stmt_;
     int last_code_, exec_count_;
+    TypeCodes types_;
+    std::vector<char> real_cols_;
+    void check_code(int code);
+    void bind_value(int i, const Value &x);
+    void fetch_value(int i, Value &x);
+    bool find_blob_row(const String &table, const String &column,
+            const String &where, const Values &params, LongInt &rowid);
 public:
     SQLiteCursorBackend(SQLiteDatabase *conn);
     ~SQLiteCursorBackend();
     void close();
     void exec_direct(const String &sql);
     void prepare(const String &sql);
+    void bind_params(const TypeCodes &types);
     void exec(const Values &params);
     RowPtr fetch_row();
+    bool fetch_values(Values &values, Strings *names);
+    bool last_insert_id(LongInt &id);
+    void reset();
+    bool blob_streams();
+    bool read_blob(const String &table, const String &column,
+            const String &where, const Values &params, std::ostream &out);
+    void write_blob(const String &table, const String &column,
+            const String &where, const Values &params,
+            std::istream &in, LongInt size);
 };
 
 class SQLiteDriver;
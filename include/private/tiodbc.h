@@ -45,6 +45,7 @@
 #include <string>
 #include <map>
 #include <stdexcept>
+#include <iostream>
 
 //! The only one namespace of TinyODBC
 /**
@@ -61,6 +62,7 @@ namespace tiodbc
 	class connection;
 	class field_impl;
 	class param_impl;
+	class param_array;
 	class statement;	
 
 	class bind_error: public std::runtime_error
@@ -71,6 +73,14 @@ namespace tiodbc
 		{}
 	};
 
+	class fetch_error: public std::runtime_error
+	{
+	public:
+		fetch_error(int col_num):
+			std::runtime_error("column data truncated, N " + Yb::to_stdstring(col_num))
+		{}
+	};
+
 	//! @name Library Version
 	//! @{
 
@@ -291,6 +301,8 @@ namespace tiodbc
 		int type;				//!< Column data type code
 		mutable int is_null_flag;	//!< Column is null (0=no, 1=yes, -1=unknown yet)
 		mutable _tstring str_buf;   //!< Column value buffer
+		const void *bound_ptr;	//!< Value in the block buffer, NULL if not bound
+		SQLSMALLINT bound_ctype;	//!< C type of the block buffer
 
 		// Not direct constructible
 		field_impl(HSTMT _stmt, int _col_num,
@@ -410,9 +422,55 @@ namespace tiodbc
 		//! Set parameter as NULL
 		void set_as_null();
 
+		//! Set parameter as binary data sent at execution
+		/**
+			The value is not kept in the parameter, it is sent
+			by statement::execute_put_binary() in chunks.
+		@param _size The length of the value in bytes.
+		*/
+		void set_as_binary_at_exec(SQLLEN _size);
+
 		//! @}
 	};	// !param_impl
 
+	//! Column-wise buffer of a parameter for several parameter sets.
+	/**
+		Used with statement::execute_batch(), one per parameter marker.
+		All the values share the C type given at construction: one of
+		SQL_C_SBIGINT, SQL_C_DOUBLE, SQL_C_TYPE_TIMESTAMP or SQL_C_TCHAR.
+		The strings are laid out in the buffer when it gets bound.
+	*/
+	class param_array
+	{
+	public:
+		friend class statement;
+
+	private:
+		SQLSMALLINT c_type;		//!< C type of the values
+		SQLLEN elem_size;		//!< Size of one value in the buffer
+		std::vector<char> data;	//!< The values
+		std::vector<SQLLEN> ind;	//!< Lengths or SQL_NULL_DATA
+		std::vector<_tstring> strs;	//!< The strings to put in the buffer
+
+		void fill_strings();
+	public:
+		param_array(size_t _rows, SQLSMALLINT _ctype);
+
+		//! Get the C type of the values
+		SQLSMALLINT get_ctype() const { return c_type; }
+
+		//! @name Value assignment functions
+		//! @{
+
+		void set_as_null(size_t _row);
+		void set_as_long_long(size_t _row, const LongLong & _value);
+		void set_as_double(size_t _row, const double & _value);
+		void set_as_date_time(size_t _row, const TIMESTAMP_STRUCT & _value);
+		void set_as_string(size_t _row, const _tstring & _str);
+
+		//! @}
+	};	// !param_array
+
 	//! An ODBC statement representation object
 	/**
 		Represents a statement on the server. Statement is used to
@@ -448,7 +506,23 @@ namespace tiodbc
 		};
 		std::vector<col_descr> m_cols;
 
+		// Column-wise bound buffers of the block fetch mode
+		struct bound_col
+		{
+			SQLSMALLINT c_type;
+			SQLLEN elem_size;
+			std::vector<char> data;
+			std::vector<SQLLEN> ind;
+		};
+		std::vector<bound_col> m_bound;
+		SQLULEN block_size;		//!< Rows requested per SQLFetch()
+		SQLULEN rows_fetched;	//!< Rows in the current block
+		SQLULEN cur_row;		//!< Current row within the block
+		bool b_block;			//!< A flag, if the result set is fetched by blocks
+
 		bool describe_cols();
+		bool bind_block();
+		void free_params();
 
 		// Uncopiable
 		statement(const statement&);
@@ -708,7 +782,74 @@ namespace tiodbc
         @ref example_2 \n
         @ref example_4
 		*/
-		const field_impl field(int _num) const;
+		const field_impl field(int _num, bool _need_name = true) const;
+
+		//! Results of execute_batch()
+		enum batch_result { batch_ok, batch_failed, batch_unsupported };
+
+		//! Execute a prepared statement for several parameter sets
+		/**
+			The parameter arrays are bound column-wise with
+			SQL_ATTR_PARAMSET_SIZE, then the statement gets executed once.
+			The parameters bound with param() are reset.
+		@param _params One array per parameter marker, all of the same size.
+		@param _status Receives the status of each parameter set,
+			SQL_PARAM_SUCCESS, SQL_PARAM_ERROR, etc.
+		@param _error Receives the error description, if any.
+		@return batch_ok, batch_failed, or batch_unsupported if the driver
+			can't take arrays of parameters, nothing is executed then.
+			batch_failed is returned as well when the execution succeeds
+			but any of the sets is marked SQL_PARAM_ERROR or
+			SQL_PARAM_DIAG_UNAVAILABLE.
+		*/
+		batch_result execute_batch(std::vector<param_array> & _params,
+				std::vector<SQLUSMALLINT> & _status, _tstring & _error);
+
+		//! Execute a prepared statement sending a binary parameter in chunks
+		/**
+			The parameter must have been set with
+			param_impl::set_as_binary_at_exec(), its data are read from
+			the stream and passed with SQLPutData, chunk by chunk.
+		@param _in The stream to read the value from.
+		@param _size The length of the value in bytes.
+		@param _chunk The size of a chunk in bytes.
+		@param _error Receives the error description, taken before
+			the statement is cancelled.
+		@return
+			- <b>True</b> if the statement was executed.
+			- <b>False</b> on an error, or if the stream has ended
+			before \a _size bytes, the statement is cancelled then.
+		*/
+		bool execute_put_binary(std::istream & _in, SQLLEN _size,
+				size_t _chunk, _tstring & _error);
+
+		//! Read a binary field of the current row in chunks
+		/**
+			Calls SQLGetData with SQL_C_BINARY until the whole value
+			is written to the stream.  The field must not have been
+			read before, and the result set must not be fetched by blocks.
+		@param _num The column of the field, first column is the 1.
+		@param _out The stream to write the value to.
+		@param _chunk The size of a chunk in bytes.
+		@param _is_null Set to true if the value is NULL.
+		@return <b>False</b> on an error.
+		*/
+		bool get_binary(int _num, std::ostream & _out, size_t _chunk,
+				bool & _is_null);
+
+		//! Set the number of rows to fetch at once
+		/**
+			With more than one row per block the columns of a result set
+			are bound to arrays (SQLBindCol) and fetched by blocks of
+			rows, using SQL_ATTR_ROW_ARRAY_SIZE. A result set having
+			a LOB column or a column of unknown size is still fetched
+			row by row with SQLGetData.
+		@param _rows The number of rows, 1 turns the block mode off.
+		*/
+		void set_block_size(int _rows);
+
+		//! Check if the current result set is fetched by blocks
+		bool block_mode() const { return b_block; }
 
 		//! Count columns of the result set
 		/**
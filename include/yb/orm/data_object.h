@@ -15,6 +15,7 @@
 #include <set>
 #include <map>
 #include "util/utility.h"
+#include "util/arena.h"
 #include "util/exception.h"
 #include "util/value_type.h"
 #include "orm_config.h"
@@ -79,10 +80,20 @@ public:
     DataObjectAlreadyInSession(const Key &key);
 };
 
+class YBORM_DECL ReadOnlySession: public ORMError
+{
+public:
+    ReadOnlySession(const String &operation);
+};
+
 #define EMPTY_DATAOBJ (::Yb::DataObject::Ptr(NULL))
 
+#define YB_LOAD_BATCH_SIZE 50
+#define YB_SIBLINGS_SCAN 8 // slots scanned per sibling wanted
+
 class DataObject;
 class RelationObject;
+class BlobStream;
 
 typedef IntrusivePtr<DataObject> DataObjectPtr;
 typedef IntrusivePtr<RelationObject> RelationObjectPtr;
@@ -92,21 +103,154 @@ typedef std::vector<DataObjectPtr> DataObjectList;
 
 class Session;
 
+/** Relations to be loaded eagerly along with the selected objects,
+ * each one is paired with the side of the relation (0 = master,
+ * 1 = slaves) the joined table is at.
+ */
+typedef std::vector<std::pair<const Relation *, int> > EagerRelations;
+
 class YBORM_DECL DataObjectResultSet: public ResultSetBase<DataObjectList>
 {
     SqlResultSet rs_;
-    std::auto_ptr<SqlResultSet::iterator> it_;
+    Values cur_;
     std::vector<const Table *> tables_;
     Session &session_;
+    EagerRelations eager_;
+    std::vector<size_t> eager_pos_;
+    size_t n_main_;
+    DataObjectList pending_;
+    std::set<std::vector<DataObject *> > seen_;
+    int limit_, offset_, n_rows_;
+    bool first_group_;
 
+    void init_eager();
+    bool fetch_objects(DataObjectList &row);
+    void link_eager(DataObjectList &row);
     bool fetch(DataObjectList &row);
     DataObjectResultSet();
 public:
+    /** With the pager limit and offset given the collections which
+     * may have been cut at the page boundaries are left Incomplete.
+     */
     DataObjectResultSet(const SqlResultSet &rs, Session &session,
-                        const Strings &tables);
+                        const Strings &tables,
+                        const EagerRelations &eager = EagerRelations(),
+                        int limit = 0, int offset = 0);
     DataObjectResultSet(const DataObjectResultSet &obj);
 };
 
+//! Relation objects of a DataObject, indexed by the relation ordinals
+/** Works like std::map<const Relation *, T__>.  The slots are
+ * allocated on the first insert, one for each relation the table
+ * is at the SIDE__ of.
+ */
+template <class T__, int SIDE__>
+class RelationSlots
+{
+public:
+    typedef std::pair<const Relation *, T__> value_type;
+    class iterator
+    {
+        value_type *p_, *end_;
+        void skip() { while (p_ != end_ && !p_->first) ++p_; }
+    public:
+        iterator(value_type *p = NULL, value_type *end = NULL)
+            : p_(p), end_(end)
+        { skip(); }
+        value_type &operator * () const { return *p_; }
+        value_type *operator -> () const { return p_; }
+        iterator &operator ++ () { ++p_; skip(); return *this; }
+        bool operator == (const iterator &o) const { return p_ == o.p_; }
+        bool operator != (const iterator &o) const { return p_ != o.p_; }
+    };
+private:
+    std::vector<value_type> slots_;
+    value_type *first() { return slots_.empty()? NULL: &slots_[0]; }
+    value_type *last() { return first() + slots_.size(); }
+public:
+    iterator begin() { return iterator(first(), last()); }
+    iterator end() { return iterator(last(), last()); }
+    size_t size() const {
+        size_t n = 0;
+        for (size_t i = 0; i < slots_.size(); ++i)
+            if (slots_[i].first)
+                ++n;
+        return n;
+    }
+    bool empty() const { return !size(); }
+    iterator find(const Relation *r) {
+        size_t i = r->ordinal(SIDE__);
+        if (i >= slots_.size() || !slots_[i].first)
+            return end();
+        return iterator(first() + i, last());
+    }
+    std::pair<iterator, bool> insert(const value_type &x) {
+        if (slots_.empty())
+            slots_.resize(x.first->table(SIDE__).rel_count(SIDE__));
+        size_t i = x.first->ordinal(SIDE__);
+        YB_ASSERT(i < slots_.size());
+        bool added = !slots_[i].first;
+        if (added)
+            slots_[i] = x;
+        return std::make_pair(iterator(first() + i, last()), added);
+    }
+    size_t erase(const Relation *r) {
+        size_t i = r->ordinal(SIDE__);
+        if (i >= slots_.size() || !slots_[i].first)
+            return 0;
+        slots_[i] = value_type();
+        return 1;
+    }
+    void swap(RelationSlots &other) { slots_.swap(other.slots_); }
+};
+
+//! Open addressing hash table of DataObjects by their keys
+/** Each mapped table gets a separate linear probing table,
+ * so the objects of the same table can be enumerated quickly.
+ * Key hash values are cached in the Key instances.
+ */
+class YBORM_DECL IdentityMap
+{
+public:
+    struct Slot {
+        size_t hash;
+        DataObject *obj;
+    };
+    typedef std::vector<Slot> Slots;
+private:
+    struct TableSlots {
+        const String *table;
+        Slots slots;
+        size_t count;
+    };
+    typedef std::vector<TableSlots> Tables;
+    Tables tables_;
+    size_t size_;
+
+    TableSlots *find_table(const String *table) const;
+    static size_t find_slot(const TableSlots &t, const Key &key, size_t hash);
+    static size_t find_slot(const TableSlots &t, const DataObject *obj);
+    static void grow(TableSlots &t);
+public:
+    IdentityMap(): size_(0) {}
+    //! Find an object by key, NULL if there is none
+    DataObject *find(const Key &key) const;
+    //! Add the object, unless there is one with the same key
+    /** Returns the object found or the object added.
+     */
+    DataObject *insert(DataObject *obj);
+    //! Remove the object with such key, if it is obj (when given)
+    bool erase(const Key &key, DataObject *obj = NULL);
+    size_t size() const { return size_; }
+    bool empty() const { return !size_; }
+    void clear();
+    void swap(IdentityMap &other);
+    //! Slots of the objects of a table, free slots have obj == NULL
+    const Slots *table_slots(const String *table) const;
+    //! Position of the object's slot in the table_slots()
+    size_t slot_pos(DataObject *obj) const;
+};
+
 //! Session handles persisted DataObjects
 /** Session class rules all over the mapped objects that should be
  * persisted in the database.  Session has associated Schema object
@@ -117,22 +261,47 @@ class YBORM_DECL Session: public NonCopyable
     friend class ::TestDataObject;
     friend class ::TestDataObjectSaveLoad;
     friend class ::TestDomainObject;
+    friend class DataObject;
+    friend class RelationObject;
     typedef std::set<DataObjectPtr> Objects;
-    typedef std::map<Key, DataObject *> IdentityMap;
+    typedef std::set<DataObject *> ObjectSet;
+    typedef std::map<const Table *, ObjectSet> ObjectsByTable;
 
     ILogger::Ptr logger_, engine_logger_;
     Objects objects_;
     IdentityMap identity_map_;
+    // Work lists of the objects to be handled on flush, and of the
+    // ones to be loaded, kept up to date on each status change
+    ObjectsByTable new_objs_, dirty_objs_, to_delete_objs_, deleted_objs_,
+                   ghost_objs_;
     const Schema &schema_;
     std::auto_ptr<EngineSource> created_engine_;
     std::auto_ptr<EngineCloned> engine_;
+    int load_batch_size_;
+    ArenaPtr arena_;
+    bool stateless_;
+    // The keys locked in the ObjectCache until the transaction ends
+    std::vector<std::pair<const Table *, Key> > cache_locks_;
 
     DataObject *add_to_identity_map(DataObject *obj, bool return_found);
+    template <class Pred>
+    void find_siblings(DataObject *obj, size_t max_count,
+                       Pred pred, std::vector<DataObject *> &out);
+    bool load_from_cache(DataObject *obj);
+    //! The object cache keeps the rows of each data source apart
+    const String &cache_source();
+    void lock_in_cache(const Table &table, const Key &key);
+    void unlock_cache();
+    void load_ghosts(DataObject *obj);
+    void load_slaves(RelationObject *ro);
     void flush_tbl_new_keyed(const Table &tbl, Objects &keyed_objs);
     void flush_tbl_new_unkeyed(const Table &tbl, Objects &unkeyed_objs);
+    ObjectsByTable *work_list(int status);
+    void status_changed(DataObject *obj, int old_status, int new_status);
     void flush_new();
-    void flush_update(IdentityMap &idmap_copy);
-    void flush_delete(IdentityMap &idmap_copy);
+    void flush_update();
+    void flush_delete();
+    void purge_deleted();
     void clone_engine(EngineSource *src_engine);
 public:
     void set_logger(ILogger::Ptr logger);
@@ -163,6 +332,31 @@ public:
      * placed in the identity_map_ and returned.
      */
     DataObjectPtr get_lazy(const Key &key);
+    /** Set the max number of Ghost objects of the same table
+     * to be loaded with a single query, when one of them is touched.
+     * The same limit applies to the number of masters, whose
+     * slave collections are fetched together.
+     */
+    void set_load_batch_size(int n) { load_batch_size_ = n; }
+    int load_batch_size() const { return load_batch_size_; }
+    /** Allocate the objects created by this session from an arena.
+     * Its memory is given back to the heap at once, when
+     * the session and all of the objects allocated are gone.
+     */
+    void use_arena(bool on = true) {
+        arena_ = ArenaPtr(on? new Arena(): NULL);
+    }
+    Arena *arena() const { return arena_.get(); }
+    /** Turn the session into a stateless read-only one.  The objects
+     * fetched by load_collection() are neither registered in the
+     * identity map nor kept by the session: each one goes away as soon
+     * as the result set iterator advances and no one else holds it.
+     * They are not linked to the session, so their relations are only
+     * available if loaded eagerly.  Any attempt to write through
+     * the session throws ReadOnlySession.
+     */
+    void set_stateless(bool on = true) { stateless_ = on; }
+    bool stateless() const { return stateless_; }
     void flush();
     void commit();
     void rollback();
@@ -176,8 +370,22 @@ public:
             const Expression &tables, const Expression &filter,
             const Expression &order_by = Expression(),
             bool for_update_flag = false);
+    /** Load objects using the query given.  The tables of eagerly
+     * loaded relations must come last in the tables list,
+     * the rows having the same leading objects are merged then.
+     */
+    DataObjectResultSet load_collection(
+            const Strings &tables, const SelectExpr &select_expr,
+            const EagerRelations &eager = EagerRelations());
+    /** Load objects using the query make_select() builds of the parts
+     * given, see EngineBase::select_iter().  The tables list tells
+     * the objects of a row, just like above.
+     */
     DataObjectResultSet load_collection(
-            const Strings &tables, const SelectExpr &select_expr);
+            const Strings &tables, const Expression &from_where,
+            const Expression &filter, const Expression &order_by,
+            bool for_update_flag, int limit, int offset,
+            const EagerRelations &eager = EagerRelations());
 };
 
 enum DeletionMode { DelNormal, DelDryRun, DelUnchecked };
@@ -204,34 +412,53 @@ public:
     typedef DataObjectPtr Ptr;
     typedef Values::iterator iterator;
     enum Status { New, Ghost, Dirty, Sync, ToBeDeleted, Deleted };
-    typedef std::map<const Relation *, RelationObject * > SlaveRelations;
-    typedef std::map<const Relation *, RelationObjectPtr> MasterRelations;
+    typedef RelationSlots<RelationObject *, 1> SlaveRelations;
+    typedef RelationSlots<RelationObjectPtr, 0> MasterRelations;
+    typedef std::vector<bool> DirtyColumns;
 private:
+    // Allocated when the first column is changed
+    struct DirtyInfo {
+        DirtyColumns cols;
+        Values orig_values;
+    };
     const Table &table_;
     Values values_;
+    // Hash of the primary key values, 0 until it is needed,
+    // and again once any of them gets changed.  Yb::key_hash()
+    // never returns 0, so a computed hash is never taken for none.
+    mutable size_t key_hash_;
     Status status_;
+    int depth_;
+    std::auto_ptr<DirtyInfo> dirty_;
     SlaveRelations slave_relations_;
     MasterRelations master_relations_;
     Session *session_;
-    Key key_;
-    bool assigned_key_;
-    int depth_;
 
     DataObject(const Table &table, Status status)
         : table_(table)
         , values_(table.size())
+        , key_hash_(0)
         , status_(status)
-        , session_(NULL)
-        , assigned_key_(false)
         , depth_(0)
+        , session_(NULL)
     {}
-    void update_key();
     void load();
     void lazy_load(const Column *c = NULL) {
         if ((!c || !c->is_pk()) && status_ == Ghost)
             load();
     }
-    void set_status(Status st) { status_ = st; }
+    void set_status(Status st) {
+        if (st != Dirty)
+            clear_dirty();
+        if (st != status_) {
+            if (session_)
+                session_->status_changed(this, status_, st);
+            status_ = st;
+        }
+    }
+    void reset_key() { key_hash_ = 0; }
+    void set_dirty(int i, Value &old_value);
+    void clear_dirty() { dirty_.reset(NULL); }
     void depth(int d) { depth_ = d; }
     void populate_all_master_relations();
 public:
@@ -239,8 +466,15 @@ public:
                      const String &relation_name, int mode);
     static void link(DataObject *master, Ptr slave,
                      const Relation &r);
-    static Ptr create_new(const Table &table, Status status = New) {
-        return Ptr(new DataObject(table, status));
+    static void *operator new(size_t size) { return arena_new(size, NULL); }
+    static void *operator new(size_t size, Arena *arena) {
+        return arena_new(size, arena);
+    }
+    static void operator delete(void *p, size_t size) { arena_delete(p, size); }
+    static void operator delete(void *p, Arena *) { arena_delete(p, 0); }
+    static Ptr create_new(const Table &table, Status status = New,
+                          Arena *arena = NULL) {
+        return Ptr(new (arena) DataObject(table, status));
     }
     ~DataObject();
     const Table &table() const { return table_; }
@@ -265,14 +499,26 @@ public:
         return get(table_.idx_by_name(name));
     }
     void touch();
+    //! Flags of the columns changed since the object has been loaded
+    const DirtyColumns &dirty_columns() const;
     void set(int i, const Value &v);
     void set(const String &name, const Value &v) {
         set(table_.idx_by_name(name), v);
     }
-    const Key &key();
+    /** Get a handle to pass the value of a BLOB column in chunks,
+     * meant for a LAZY column, see Column::LAZY.
+     */
+    BlobStream blob_stream(int i);
+    BlobStream blob_stream(const String &name);
+    //! The key is made of the primary key values on each call
+    const Key key() const;
+    /** The hash of key() is kept until the primary key values change,
+     * the primary key columns must be changed with set() for that.
+     */
+    size_t key_hash() const;
     Key fk_value_for(const Relation &r);
     const Values &raw_values() const { return values_; }
-    bool assigned_key();
+    bool assigned_key() const;
     SlaveRelations &slave_relations() {
         return slave_relations_;
     }
@@ -280,6 +526,7 @@ public:
         return master_relations_;
     }
     size_t fill_from_row(Row &r, size_t pos = 0);
+    size_t fill_from_row(Values &r, size_t pos = 0);
     void refresh_slaves_fkeys();
     void refresh_master_fkeys();
 
@@ -305,6 +552,28 @@ public:
     void dump_tree(std::ostream &out, int level = 0);
 };
 
+//! A handle to the value of a BLOB column of a DataObject
+/** The value goes straight between the stream and the row in the
+ * database, by chunks if the driver can do so, and it is never kept
+ * in the object.  The object gets flushed first if it is new.
+ * Don't set() the same column while using the stream.
+ */
+class YBORM_DECL BlobStream
+{
+    DataObjectPtr obj_;
+    int col_;
+    const Key key_for_stream();
+public:
+    BlobStream(DataObjectPtr obj, int col): obj_(obj), col_(col) {}
+    //! Write the value to the stream, returns false for a NULL
+    bool read(std::ostream &out);
+    /** Replace the value with \a size bytes read from the stream.
+     * A stream ending early throws ShortBlobStream and changes nothing,
+     * after other errors the session has to be rolled back.
+     */
+    void write(std::istream &in, LongInt size);
+};
+
 //! Represents an instance of 1-to-many relation.
 /** Some facts about RelationObject class <ul>
   <li>Object is always allocated in heap, pointer to object = object's identity.
@@ -338,8 +607,15 @@ private:
     void add_slave(DataObject::Ptr slave);
     void remove_slave(DataObject::Ptr slave);
 public:
+    static void *operator new(size_t size) { return arena_new(size, NULL); }
+    static void *operator new(size_t size, Arena *arena) {
+        return arena_new(size, arena);
+    }
+    static void operator delete(void *p, size_t size) { arena_delete(p, size); }
+    static void operator delete(void *p, Arena *) { arena_delete(p, 0); }
     static Ptr create_new(const Relation &rel_info, DataObject *master) {
-        return Ptr(new RelationObject(rel_info, master));
+        Arena *arena = master->session()? master->session()->arena(): NULL;
+        return Ptr(new (arena) RelationObject(rel_info, master));
     }
     const Relation &relation_info() const { return relation_info_; }
     void master_object(DataObject *obj) { master_object_ = obj; }
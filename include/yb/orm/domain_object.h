@@ -2,6 +2,7 @@
 #ifndef YB__ORM__DOMAIN_OBJECT__INCLUDED
 #define YB__ORM__DOMAIN_OBJECT__INCLUDED
 
+#include <algorithm>
 #include <iterator>
 #include <stdexcept>
 #include "orm_config.h"
@@ -46,6 +47,20 @@ public:
     InvalidIterator();
 };
 
+class YBORM_DECL NoRelationFound: public ORMError
+{
+public:
+    NoRelationFound(const String &class1, const String &relation_name,
+            const String &class2);
+};
+
+class YBORM_DECL EagerSelfRelation: public ORMError
+{
+public:
+    EagerSelfRelation(const String &class_name,
+            const String &relation_name);
+};
+
 template <class T>
 class ManagedList;
 
@@ -641,9 +656,68 @@ class QueryObj {
     Session *session_;
     const Table *select_from_;
     JoinList joins_;
+    EagerRelations eager_;
     Expression filter_, order_;
     bool for_update_;
     int limit_, offset_;
+
+    const Table &main_table() {
+        if (select_from_)
+            return *select_from_;
+        Strings tables;
+        QF::list_tables(tables);
+        return session_->schema().table(tables[0]);
+    }
+
+    Expression add_eager_joins(Expression from_where, Strings &tables,
+            Expression &order) {
+        const Strings main_tables(tables);
+        Strings owners;
+        EagerRelations::iterator it = eager_.begin(), end = eager_.end();
+        for (; it != end; ++it) {
+            const Table &other = it->first->table(it->second);
+            from_where = JoinExpr(from_where, ColumnExpr(other.name()),
+                    it->first->join_condition(), true);
+            tables.push_back(other.name());
+            const String &owner = it->first->table(0).name();
+            if (it->second == 1 && std::find(owners.begin(), owners.end(),
+                        owner) == owners.end())
+                owners.push_back(owner);
+        }
+        if (!owners.size())
+            return from_where;
+        // Keep the rows of each selected tuple together, the owners
+        // of the eager slaves go first
+        for (size_t i = 0; i < main_tables.size(); ++i)
+            if (std::find(owners.begin(), owners.end(),
+                        main_tables[i]) == owners.end())
+                owners.push_back(main_tables[i]);
+        ExpressionList order_list;
+        ExpressionListBackend *list_be =
+            dynamic_cast<ExpressionListBackend *>(order_.backend());
+        if (list_be) {
+            for (int i = 0; i < list_be->size(); ++i)
+                order_list << list_be->item(i);
+        }
+        else if (!order_.is_empty())
+            order_list << order_;
+        for (size_t i = 0; i < owners.size(); ++i) {
+            const Table &t = session_->schema().table(owners[i]);
+            const Strings &pk_fields = t.pk_fields();
+            for (size_t j = 0; j < pk_fields.size(); ++j)
+                order_list << ColumnExpr(t.name(), pk_fields[j]);
+        }
+        order = order_list;
+        return from_where;
+    }
+
+    DataObjectResultSet load() {
+        Strings tables;
+        Expression order;
+        Expression from_where = get_from(tables, order);
+        return session_->load_collection(tables, from_where,
+                filter_, order, for_update_, limit_, offset_, eager_);
+    }
 public:
     QueryObj(Session &session, const Expression &filter = Expression(),
             const Expression &order = Expression(), bool for_update = false)
@@ -719,7 +793,9 @@ public:
                             it->first->class_name()
                             );
                 }
-                YB_ASSERT(rel != NULL);
+                if (!rel)
+                    throw NoRelationFound(select_from_->class_name(),
+                            String(), it->first->class_name());
                 join_expr = JoinExpr(join_expr,
                         ColumnExpr(it->first->name()),
                         rel->join_condition());
@@ -729,6 +805,36 @@ public:
         return join_expr;
     }
 
+    /** Load the related objects of class D with the same query
+     * using LEFT JOIN: either the master object, or the collection
+     * of slave objects.  Note that range() applies to the joined rows,
+     * the collections cut at the page boundaries are left Incomplete
+     * and get loaded in full on the first access.
+     */
+    template <class D>
+    QueryObj with(const String &relation_name = _T(""))
+    {
+        QueryObj q(*this);
+        const Schema &schema = session_->schema();
+        const Table &main = main_table();
+        const String &other_class =
+            schema.table(D::get_table_name()).class_name();
+        const Relation *rel = schema.find_relation(
+                main.class_name(), relation_name, other_class, 0);
+        if (!rel)
+            rel = schema.find_relation(
+                    main.class_name(), relation_name, other_class, 1);
+        if (!rel)
+            throw NoRelationFound(main.class_name(), relation_name,
+                    other_class);
+        // The same table joined twice would need an alias
+        if (&rel->table(0) == &rel->table(1))
+            throw EagerSelfRelation(main.class_name(), relation_name);
+        q.eager_.push_back(std::make_pair(rel,
+                    &rel->table(0) == &main? 1: 0));
+        return q;
+    }
+
     QueryObj filter_by(const Expression &filter) {
         QueryObj q(*this);
         if (q.filter_.is_empty())
@@ -757,32 +863,33 @@ public:
         return q;
     }
 
-    SelectExpr get_select(Strings &tables) {
+    Expression get_from(Strings &tables, Expression &order) {
+        order = order_;
+        Expression from_where;
         if (!joins_.size()) {
             QF::list_tables(tables);
-            Expression from_where = session_->schema().join_expr(tables);
-            return make_select(session_->schema(),
-                    from_where,
-                    filter_, order_, for_update_, limit_, offset_);
+            from_where = session_->schema().join_expr(tables);
         }
-        Expression from_where = make_join(tables);
-        return make_select(session_->schema(),
-                from_where,
-                filter_, order_, for_update_, limit_, offset_);
+        else
+            from_where = make_join(tables);
+        if (eager_.size())
+            return add_eager_joins(from_where, tables, order);
+        return from_where;
+    }
+
+    SelectExpr get_select(Strings &tables) {
+        Expression order;
+        Expression from_where = get_from(tables, order);
+        return make_select(session_->schema(), from_where,
+                filter_, order, for_update_, limit_, offset_);
     }
 
     DomainResultSet<R> all() {
-        Strings tables;
-        SelectExpr select_expr = get_select(tables);
-        return DomainResultSet<R>(session_->load_collection(
-                    tables, select_expr));
+        return DomainResultSet<R>(load());
     }
 
     R one() {
-        Strings tables;
-        SelectExpr select_expr = get_select(tables);
-        DomainResultSet<R> r = session_->load_collection(
-                tables, select_expr);
+        DomainResultSet<R> r = load();
         typename DomainResultSet<R>::iterator it = r.begin();
         if (it == r.end())
             throw NoDataFound("No data");
@@ -795,7 +902,9 @@ public:
     LongInt count() {
         SelectExpr select(Expression(_T("COUNT(*) CNT")));
         Strings tables;
-        select.from_(ColumnExpr(get_select(tables), _T("X")));
+        QueryObj q(*this);
+        q.eager_.clear();
+        select.from_(ColumnExpr(q.get_select(tables), _T("X")));
         SqlResultSet rs = session_->engine()->select_iter(select);
         Row r = *rs.begin();
         return r[0].second.as_longint();
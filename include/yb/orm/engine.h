@@ -20,6 +20,9 @@ class TestEngine;
 
 namespace Yb {
 
+//! Parameter sets passed to SqlCursor::exec_batch() at once
+#define YB_EXEC_BATCH_SIZE 1000
+
 class YBORM_DECL EngineBase
 {
 public:
@@ -34,6 +37,15 @@ public:
 
     SqlResultSet exec_select(const String &sql, const Values &params);
     SqlResultSet select_iter(const Expression &select_expr);
+    /** Run the query make_select() builds of the parts given.
+     * The SQL is taken from the schema's QueryCache if a query
+     * of the same shape has been run before, then only the new
+     * parameters are bound.
+     */
+    SqlResultSet select_iter(const Schema &schema,
+            const Expression &from_where, const Expression &filter,
+            const Expression &order_by, bool for_update_flag,
+            int limit, int offset, Strings &tables);
     RowsPtr select(
         const Expression &what,
         const Expression &from,
@@ -43,10 +55,26 @@ public:
         const Expression &order_by = Expression(),
         int max_rows = -1,
         bool for_update = false);
+    /** Insert the rows.  Unless the new ids are collected, the
+     * statements get executed by batches of parameter sets, then
+     * a BatchExecError tells the positions of the failed rows.
+     * So do update() and delete_from().
+     */
     const std::vector<LongInt> insert(const Table &table,
             const RowsData &rows, bool collect_new_ids);
-    void update(const Table &table, const RowsData &rows);
+    void update(const Table &table, const RowsData &rows,
+            const std::vector<bool> *columns = NULL);
     void delete_from(const Table &table, const Keys &keys);
+    /** Stream the value of a BLOB column of the row with the key
+     * given, see SqlCursor::read_blob().  Returns false for a NULL.
+     */
+    bool read_blob(const Table &table, const String &column,
+            const Key &key, std::ostream &out);
+    /** Store \a size bytes read from the stream into a BLOB column,
+     * see SqlCursor::write_blob() for what's left after an error.
+     */
+    void write_blob(const Table &table, const String &column,
+            const Key &key, std::istream &in, LongInt size);
     void exec_proc(const String &proc_code);
     RowPtr select_row(const Expression &what,
             const Expression &from, const Expression &where);
@@ -61,14 +89,35 @@ public:
     void create_schema(const Schema &schema, bool ignore_errors = false);
     void drop_schema(const Schema &schema, bool ignore_errors = false);
 
+    /** Generate an INSERT statement for n_rows rows, the way the
+     * insert_model (one of SqlInsertModel) tells.  The param_nums
+     * are given for the first row, the type_codes for all of them.
+     * The statement returns the surrogate key generated, as
+     * the returning_model (one of SqlReturningModel) tells.
+     */
     static void gen_sql_insert(String &sql, TypeCodes &type_codes,
             ParamNums &param_nums, const Table &table,
-            bool include_pk, bool numbered_params = false);
+            bool include_pk, bool numbered_params = false,
+            int n_rows = 1, int insert_model = INSERT_ONE_ROW,
+            int returning_model = RETURNING_NONE);
     static void gen_sql_update(String &sql, TypeCodes &type_codes,
             ParamNums &param_nums, const Table &table,
-            const SqlGeneratorOptions &options);
+            const SqlGeneratorOptions &options,
+            const std::vector<bool> *columns = NULL);
     static void gen_sql_delete(String &sql, TypeCodes &type_codes,
-            const Table &table, const SqlGeneratorOptions &options);
+            const Table &table, const SqlGeneratorOptions &options,
+            int n_keys = 1);
+private:
+    const SqlGeneratorOptions sql_options();
+    SqlResultSet exec_select_retry(const String &sql, const Values &params);
+    // The DML plans are cached in the Table per dialect and driver,
+    // tmp is filled and returned when the cache is full.
+    const String dml_plan_key(const String &op, const String &args);
+    const DmlPlan &insert_plan(const Table &table, bool include_pk,
+            int n_rows, int returning_model, DmlPlan &tmp);
+    const DmlPlan &update_plan(const Table &table,
+            const std::vector<bool> *columns, DmlPlan &tmp);
+    const DmlPlan &delete_plan(const Table &table, int n_keys, DmlPlan &tmp);
 };
 
 class YBORM_DECL EngineCloned: public EngineBase
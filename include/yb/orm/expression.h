@@ -207,10 +207,12 @@ public:
 class YBORM_DECL JoinExprBackend: public ExpressionBackend
 {
     Expression expr1_, expr2_, cond_;
+    bool outer_;
 public:
     JoinExprBackend(const Expression &expr1,
-            const Expression &expr2, const Expression &cond)
-        : expr1_(expr1), expr2_(expr2), cond_(cond) {}
+            const Expression &expr2, const Expression &cond,
+            bool outer = false)
+        : expr1_(expr1), expr2_(expr2), cond_(cond), outer_(outer) {}
     const String generate_sql(
             const SqlGeneratorOptions &options,
             SqlGeneratorContext *ctx) const;
@@ -220,19 +222,22 @@ public:
     Expression &expr2() { return expr2_; }
     const Expression &cond() const { return cond_; }
     Expression &cond() { return cond_; }
+    bool outer() const { return outer_; }
 };
 
 class YBORM_DECL JoinExpr: public Expression
 {
 public:
     JoinExpr(const Expression &expr1,
-            const Expression &expr2, const Expression &cond);
+            const Expression &expr2, const Expression &cond,
+            bool outer = false);
     const Expression &expr1() const;
     const Expression &expr2() const;
     Expression &expr1();
     Expression &expr2();
     const Expression &cond() const;
     Expression &cond();
+    bool outer() const;
 };
 
 class YBORM_DECL ExpressionListBackend: public ExpressionBackend
@@ -463,8 +468,8 @@ class YBORM_DECL FilterBackendByPK: public ExpressionBackend
 {
     Expression expr_;
     Key key_;
-    static const Expression build_expr(const Key &key);
 public:
+    static const Expression build_expr(const Key &key);
     FilterBackendByPK(const Key &key);
     const String generate_sql(
             const SqlGeneratorOptions &options,
@@ -483,9 +488,38 @@ public:
     Expression &expr();
 };
 
+class YBORM_DECL FilterBackendByKeys: public ExpressionBackend
+{
+    Expression expr_;
+    Keys keys_;
+    static const Expression build_expr(const Keys &keys);
+public:
+    FilterBackendByKeys(const Keys &keys);
+    const String generate_sql(
+            const SqlGeneratorOptions &options,
+            SqlGeneratorContext *ctx) const;
+    const Keys &keys() const { return keys_; }
+    const Expression &expr() const { return expr_; }
+    Expression &expr() { return expr_; }
+};
+
+//! Filter matching any of the given keys of the same table
+/** For keys with a single column an IN-list is generated,
+ * composite keys are matched with OR-ed groups of AND-ed terms.
+ */
+class YBORM_DECL KeysFilter: public Expression
+{
+public:
+    KeysFilter(const Keys &keys);
+    const Keys &keys() const;
+    const Expression &expr() const;
+    Expression &expr();
+};
+
 typedef Expression Filter;
 
 class Schema;
+class Table;
 
 YBORM_DECL void find_all_tables(const Expression &expr, Strings &tables);
 
@@ -495,6 +529,11 @@ YBORM_DECL void set_table_aliases_on_cond(
 YBORM_DECL void set_table_aliases_on_cols(
         Expression &expr, const string_map &aliases, bool add_col_aliases);
 
+/** Append the columns to load the objects of a table with.
+ * A lazy column gets a NULL in its place, so the positions stay.
+ */
+YBORM_DECL void add_object_columns(ExpressionList &cols, const Table &table);
+
 YBORM_DECL SelectExpr make_select(const Schema &schema, const Expression &from_where,
         const Expression &filter, const Expression &order_by,
         bool for_update_flag = false, int limit = 0, int offset = 0,
@@ -0,0 +1,78 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#ifndef YB__ORM__ID_GENERATOR__INCLUDED
+#define YB__ORM__ID_GENERATOR__INCLUDED
+
+#include <map>
+#include "util/thread.h"
+#include "orm_config.h"
+#include "schema.h"
+
+namespace Yb {
+
+class EngineBase;
+
+class YBORM_DECL IdGeneratorError: public MetaDataError
+{
+public:
+    IdGeneratorError(const String &name);
+};
+
+class YBORM_DECL IdGeneratorConflict: public MetaDataError
+{
+public:
+    IdGeneratorConflict(const String &table_name, const String &seq_name);
+};
+
+//! Source of surrogate key values for the tables using a sequence
+class YBORM_DECL IdGenerator: NonCopyable
+{
+public:
+    virtual ~IdGenerator();
+    virtual LongInt next_id(EngineBase &engine) = 0;
+};
+
+//! Takes each id from the sequence, one query per id
+class YBORM_DECL SequenceIdGenerator: public IdGenerator
+{
+    String seq_name_;
+public:
+    SequenceIdGenerator(const String &seq_name);
+    LongInt next_id(EngineBase &engine);
+};
+
+//! Hands out blocks of ids, one query per block
+/** Each value hi taken from the sequence reserves the ids
+ * from hi * block to hi * block + block - 1.  Thus the sequence
+ * can't be used to make the ids of the same table elsewhere.
+ */
+class YBORM_DECL HiLoIdGenerator: public IdGenerator
+{
+    String seq_name_;
+    int block_;
+    LongInt next_, end_;
+    Mutex mutex_;
+protected:
+    virtual LongInt next_hi(EngineBase &engine);
+public:
+    HiLoIdGenerator(const String &seq_name, int block);
+    LongInt next_id(EngineBase &engine);
+};
+
+typedef IdGenerator *(*IdGeneratorCreator)(const String &seq_name, int block);
+
+//! Make the id generator known by its name in the schema
+YBORM_DECL void register_id_generator(const String &name,
+                                      IdGeneratorCreator creator);
+
+/** Get the id generator of the table, shared by all the sessions
+ * working with the same data source.  The tables using the same
+ * sequence must agree on the id generator and its block, or else
+ * IdGeneratorConflict is thrown.
+ */
+YBORM_DECL IdGenerator &table_id_generator(const Table &table,
+                                           EngineBase &engine);
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
+#endif // YB__ORM__ID_GENERATOR__INCLUDED
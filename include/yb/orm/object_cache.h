@@ -0,0 +1,82 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#ifndef YB__ORM__OBJECT_CACHE__INCLUDED
+#define YB__ORM__OBJECT_CACHE__INCLUDED
+
+#include <map>
+#include <list>
+#include <time.h>
+#include "util/thread.h"
+#include "orm_config.h"
+#include "schema.h"
+
+namespace Yb {
+
+//! Second-level cache of the table rows, shared by all the sessions
+/** The rows are kept apart for each data source, the source is
+ * given by the SqlSource::id() of the session's connection.
+ * Only the tables opted in via the cache-ttl/cache-size attributes
+ * in the schema are cached.  Session consults the cache before
+ * loading a Ghost object.  The rows it updates or deletes on flush
+ * are locked: they are neither served nor accepted by the cache
+ * until the transaction ends with commit or rollback.
+ * A row expires after cache_ttl() seconds, the least
+ * recently used rows are evicted when cache_size() is exceeded.
+ * All methods are thread-safe.
+ */
+class YBORM_DECL ObjectCache: NonCopyable
+{
+public:
+    ObjectCache();
+    //! Copy the cached row of the key into values, if not expired
+    bool get(const String &source, const Table &table, const Key &key,
+             Values &values);
+    //! Take before loading the rows to put, see put()
+    unsigned long stamp(const String &source, const Table &table);
+    /** Store the row loaded, unless the key is locked or any row of
+     * the table has been unlocked after the stamp was taken.
+     */
+    void put(const String &source, const Table &table, const Key &key,
+             const Values &values, unsigned long stamp);
+    void remove(const String &source, const Table &table, const Key &key);
+    //! Drop the row and refuse it while a transaction is changing it
+    void lock(const String &source, const Table &table, const Key &key);
+    //! The transaction is over, drop the row once again
+    void unlock(const String &source, const Table &table, const Key &key);
+    void clear();
+    size_t size();
+    size_t hits();
+    size_t misses();
+private:
+    typedef std::list<String> LruList;
+    struct Entry {
+        Values values;
+        time_t expires;
+        LruList::iterator lru_pos;
+    };
+    typedef std::map<String, Entry> Entries;
+    typedef std::map<String, int> LockCounts;
+    struct TableCache {
+        Entries entries;
+        // The most recently used keys go first
+        LruList lru;
+        LockCounts locks;
+        unsigned long stamp;
+        TableCache(): stamp(0) {}
+    };
+    // Keyed by the source id and the table name
+    typedef std::map<std::pair<String, String>, TableCache> TableCaches;
+
+    void erase(TableCache &tc, Entries::iterator i);
+    void erase(TableCache &tc, const String &key_str);
+
+    TableCaches tables_;
+    size_t hits_, misses_;
+    Mutex mutex_;
+};
+
+YBORM_DECL ObjectCache &theObjectCache();
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
+#endif // YB__ORM__OBJECT_CACHE__INCLUDED
@@ -0,0 +1,69 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#ifndef YB__ORM__QUERY_CACHE__INCLUDED
+#define YB__ORM__QUERY_CACHE__INCLUDED
+
+#include <map>
+#include <list>
+#include "util/utility.h"
+#include "util/data_types.h"
+#include "util/thread.h"
+#include "orm_config.h"
+
+namespace Yb {
+
+#define YB_QUERY_CACHE_SIZE 1000
+
+//! Generated SQL of a select query built by make_select()
+struct CompiledQuery
+{
+    String sql;
+    //! Tables the columns are selected from, in the order of the columns
+    Strings tables;
+};
+
+//! Compiled select queries of a Schema, by the shape of the query
+/** The key is the SQL of the query skeleton: the FROM, WHERE,
+ * ORDER BY and pager clauses without the column list, having
+ * the constants replaced with parameter marks.  The aliases and
+ * the column list only depend on the tables, and they don't
+ * contain any parameters, so the parameters collected with the key
+ * are the ones of the cached query in the same order.
+ * The least recently used queries are evicted when max_size()
+ * is exceeded.  All methods are thread-safe.
+ */
+class YBORM_DECL QueryCache: NonCopyable
+{
+public:
+    QueryCache();
+    bool get(const String &key, CompiledQuery &query);
+    void put(const String &key, const CompiledQuery &query);
+    void set_enabled(bool enabled);
+    bool enabled();
+    void set_max_size(size_t max_size);
+    size_t max_size();
+    void clear();
+    size_t size();
+    size_t hits();
+    size_t misses();
+private:
+    typedef std::list<String> LruList;
+    struct Entry {
+        CompiledQuery query;
+        LruList::iterator lru_pos;
+    };
+    typedef std::map<String, Entry> Entries;
+
+    void shrink(size_t max_size);
+
+    Entries entries_;
+    // The most recently used keys go first
+    LruList lru_;
+    bool enabled_;
+    size_t max_size_, hits_, misses_;
+    Mutex mutex_;
+};
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
+#endif // YB__ORM__QUERY_CACHE__INCLUDED
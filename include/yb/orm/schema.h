@@ -14,6 +14,7 @@
 #include "orm_config.h"
 #include "expression.h"
 #include "sql_driver.h"
+#include "query_cache.h"
 
 class TestMetaData;
 
@@ -116,7 +117,11 @@ T *check_not_null(T *p, U ctx)
 class YBORM_DECL Column
 {
 public:
-    enum { PK = 1, RO = 2, NULLABLE = 4 };
+    /** A LAZY column is not fetched with the rest of the row, it reads
+     * as NULL until set.  Its value is meant to be streamed, see
+     * DataObject::blob_stream().
+     */
+    enum { PK = 1, RO = 2, NULLABLE = 4, LAZY = 8 };
     explicit Column(const String &name = _T(""),
             int type = 0, size_t size = 0, int flags = 0);
     Column(const String &name, int type, size_t size, int flags,
@@ -138,6 +143,7 @@ public:
     bool is_pk() const { return (flags_ & PK) != 0; }
     bool is_ro() const { return (flags_ & RO) != 0; }
     bool is_nullable() const { return (flags_ & NULLABLE) != 0; }
+    bool is_lazy() const { return (flags_ & LAZY) != 0; }
     bool has_fk() const {
         return !str_empty(fk_table_name_) && !str_empty(fk_name_);
     }
@@ -182,6 +188,20 @@ typedef std::map<String, int> IndexMap;
 class Schema;
 class Relation;
 
+#define YB_CACHE_TTL 60 // sec.
+#define YB_CACHE_SIZE 1000
+#define YB_ID_BLOCK 100
+#define YB_MAX_DML_PLANS 64
+
+//! Compiled DML statement of a table, built once by EngineBase
+struct DmlPlan
+{
+    String sql;
+    TypeCodes type_codes;
+    //! Index of the table column bound to each parameter of a row
+    std::vector<int> col_idx;
+};
+
 class YBORM_DECL Table: NonCopyable
 {
     Table();
@@ -200,6 +220,10 @@ public:
     const String &class_name() const { return class_name_; }
     const String &seq_name() const { return seq_name_; }
     bool autoinc() const { return autoinc_; }
+    //! Name of the IdGenerator used with the sequence, empty = default
+    const String &id_generator() const { return id_generator_; }
+    //! Number of ids reserved at once by the IdGenerator
+    int id_block() const { return id_block_; }
     const Column &column(size_t idx) const { return cols_[idx]; }
     const Column &column(const String &col_name) const
         { return cols_[idx_by_name(col_name)]; }
@@ -226,24 +250,60 @@ public:
     Table &operator << (Column &c) { add_column(c); c.set_table(*this); return *this; }
     void set_seq_name(const String &seq_name);
     void set_autoinc(bool autoinc) { autoinc_ = autoinc; }
+    void set_id_generator(const String &name, int block = YB_ID_BLOCK) {
+        id_generator_ = name;
+        id_block_ = block;
+    }
     void set_name(const String &name) { name_ = name; }
     void set_xml_name(const String &xml_name) { xml_name_ = xml_name; }
     void set_class_name(const String &class_name) { class_name_ = class_name; }
     void set_depth(int depth) { depth_ = depth; }
+    //! Keep the rows of this table in the process-wide ObjectCache
+    void set_cache(int ttl, int max_size) {
+        cache_ttl_ = ttl;
+        cache_size_ = max_size;
+    }
+    bool cached() const { return cache_ttl_ > 0 && cache_size_ > 0; }
+    //! Seconds a cached row is valid for
+    int cache_ttl() const { return cache_ttl_; }
+    //! Max number of cached rows of the table
+    int cache_size() const { return cache_size_; }
     const Strings &pk_fields() const { return pk_fields_; }
+    //! Indices of the primary key columns
+    const std::vector<int> &pk_indices() const { return pk_idx_; }
+    //! Number of relations the table is at the given side of
+    int rel_count(int side) const { return rel_count_[side]; }
+    int add_rel_ordinal(int side) { return rel_count_[side]++; }
+    void reset_rel_count() { rel_count_[0] = rel_count_[1] = 0; }
     void mk_sample_key(TypeCodes &type_codes, Key &sample_key) const;
     bool mk_key(const Values &row_values, Key &key) const;
     bool mk_key(const Row &row_values, Key &key) const;
+    //! Tell if mk_key() would make a key equal to the given one
+    bool same_key(const Values &row_values, const Key &key) const;
+    //! Tell if the rows have equal primary key values
+    bool same_key(const Values &row_values1,
+            const Values &row_values2) const;
     const Key mk_key(const Row &row_values) const;
     const Key mk_key(LongInt id) const;
+    //! Get the DML plan stored under the key, NULL if not built yet
+    const DmlPlan *find_dml_plan(const String &key) const;
+    //! Store the DML plan, NULL if there are YB_MAX_DML_PLANS already
+    const DmlPlan *add_dml_plan(const String &key, const DmlPlan &plan) const;
 private:
-    String name_, xml_name_, class_name_, seq_name_;
+    typedef std::map<String, DmlPlan> DmlPlans;
+    String name_, xml_name_, class_name_, seq_name_, id_generator_;
     bool autoinc_;
+    int id_block_;
     Columns cols_;
     IndexMap indicies_;
     Strings pk_fields_;
+    std::vector<int> pk_idx_;
+    int rel_count_[2];
     int depth_;
+    int cache_ttl_, cache_size_;
     Schema *schema_;
+    mutable DmlPlans dml_plans_;
+    mutable Mutex dml_plans_mutex_;
 };
 
 typedef std::vector<Table::Ptr> Tables;
@@ -282,6 +342,12 @@ public:
                 _T("get relation's table"));
     }
     const Strings &fk_fields() const { return fk_fields_; }
+    //! Dense index of the relation among the ones of table(n) at side n
+    int ordinal(int n) const { return n == 0? ordinal1_: ordinal2_; }
+    void set_ordinals(int ordinal1, int ordinal2) {
+        ordinal1_ = ordinal1;
+        ordinal2_ = ordinal2;
+    }
     bool eq(const Relation &o);
     Expression join_condition() const;
 private:
@@ -290,6 +356,7 @@ private:
     AttrMap attr1_, attr2_;
     Table *table1_, *table2_;
     Strings fk_fields_;
+    int ordinal1_, ordinal2_;
 };
 
 typedef std::vector<Relation::Ptr> Relations;
@@ -338,6 +405,8 @@ public:
 
     void fill_fkeys();
     void check_cycles();
+    //! The select queries made for the tables of the schema
+    QueryCache &query_cache() const { return query_cache_; }
 
     // export to text
     void export_ddl(const String &output_file, const String &dialect_name) const;
@@ -358,6 +427,7 @@ private:
     TblMap tables_;
     RelMap rels_;
     RelVect relations_;
+    mutable QueryCache query_cache_;
 };
 
 YBORM_DECL const String mk_xml_name(const String &name, const String &xml_name);
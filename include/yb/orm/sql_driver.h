@@ -6,7 +6,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <list>
 #include <iterator>
+#include <iostream>
 #include "util/utility.h"
 #include "util/thread.h"
 #include "util/result_set.h"
@@ -53,6 +55,28 @@ public:
     SqlDriverError(const String &msg);
 };
 
+//! Some parameter sets of SqlCursor::exec_batch() have failed
+class YBORM_DECL BatchExecError: public DBError
+{
+    String reason_;
+    std::vector<size_t> failed_rows_;
+public:
+    BatchExecError(const String &reason,
+                   const std::vector<size_t> &failed_rows);
+    ~BatchExecError() throw() {}
+    //! The error message of the driver
+    const String &reason() const { return reason_; }
+    //! Positions of the failed parameter sets, as far as the driver tells
+    const std::vector<size_t> &failed_rows() const { return failed_rows_; }
+};
+
+//! The stream given to SqlCursor::write_blob() has ended too early
+class YBORM_DECL ShortBlobStream: public RunTimeError
+{
+public:
+    ShortBlobStream();
+};
+
 class SqlCursor;
 class SqlConnection;
 class SqlPool;
@@ -76,6 +100,23 @@ struct ColumnInfo
 
 typedef std::vector<ColumnInfo> ColumnsInfo;
 
+//! The way to insert several rows with a single statement
+enum SqlInsertModel {
+    INSERT_ONE_ROW = 0, // no way, one row per statement
+    INSERT_VALUES_LIST, // INSERT INTO T (...) VALUES (...), (...)
+    INSERT_ALL          // INSERT ALL INTO T (...) VALUES (...) ... SELECT
+};
+
+//! The way an INSERT statement returns the generated key
+enum SqlReturningModel {
+    RETURNING_NONE = 0, // no way, the driver or select_last_inserted_id()
+                        // tells it
+    RETURNING_CLAUSE,   // INSERT INTO T (...) VALUES (...) RETURNING ID
+    RETURNING_OUTPUT_INTO // INSERT INTO T (...) OUTPUT INSERTED.ID INTO @T
+                        // VALUES (...), then SELECT from @T, fine with
+                        // the tables having triggers
+};
+
 class YBORM_DECL SqlDialect: NonCopyable
 {
     String name_, dual_;
@@ -115,6 +156,18 @@ public:
             const String &default_value);
     virtual int pager_model();
     virtual const String grant_insert_id_statement(const String &table_name, bool on);
+    //! Max number of bound parameters (or IN-list items) per statement
+    virtual int max_params();
+    //! One of SqlInsertModel
+    virtual int insert_model();
+    //! Max number of rows inserted by a single statement
+    virtual int max_insert_rows();
+    //! One of SqlReturningModel
+    virtual int returning_model();
+    /** Whether the rows inserted by a single statement get
+     * consecutive generated keys, in the order of the rows.
+     */
+    virtual bool consecutive_insert_ids();
     // schema introspection
     virtual bool table_exists(SqlConnection &conn, const String &table) = 0;
     virtual bool view_exists(SqlConnection &conn, const String &table) = 0;
@@ -135,6 +188,22 @@ typedef std::vector<Row> Rows;
 typedef std::auto_ptr<Rows> RowsPtr;
 typedef std::vector<int> TypeCodes;
 
+//! Column names of a result set, shared by all of its rows
+class YBORM_DECL RowHeader: public RefCountBase
+{
+    Strings names_;
+    std::map<String, int> idx_;
+public:
+    explicit RowHeader(const Strings &names);
+    size_t size() const { return names_.size(); }
+    const String &name(size_t i) const { return names_[i]; }
+    const Strings &names() const { return names_; }
+    //! Position of the column, or -1 if there is no such column
+    int idx_by_name(const String &name) const;
+};
+
+typedef IntrusivePtr<RowHeader> RowHeaderPtr;
+
 class YBORM_DECL SqlCursorBackend: NonCopyable
 {
 public:
@@ -144,7 +213,41 @@ public:
     virtual void prepare(const String &sql) = 0;
     virtual void bind_params(const TypeCodes &types);
     virtual void exec(const Values &params) = 0;
+    /** Execute the prepared statement once per parameter set, a DML
+     * one only.  The default implementation calls exec() in a loop.
+     * Throws BatchExecError telling which sets have failed.
+     */
+    virtual void exec_batch(const std::vector<Values> &params_rows);
     virtual RowPtr fetch_row() = 0;
+    /** Fetch the next row by position.  The column names are only
+     * filled in when \a names is not NULL, that is once per result set.
+     * The default implementation goes through fetch_row().
+     */
+    virtual bool fetch_values(Values &values, Strings *names);
+    /** Get the key generated by the last INSERT from the driver,
+     * if it can tell it without another query.
+     */
+    virtual bool last_insert_id(LongInt &id);
+    //! Drop the pending results, keep the statement prepared
+    virtual void reset();
+    /** Tell if read_blob() and write_blob() can pass the value
+     * in chunks.  Otherwise SqlCursor moves it whole with a plain
+     * SELECT or UPDATE statement.
+     */
+    virtual bool blob_streams();
+    /** Write the value of a BLOB column of the only row selected
+     * by \a where to the stream.  Returns false for a NULL value,
+     * throws NoDataFound if there is no such row.
+     */
+    virtual bool read_blob(const String &table, const String &column,
+            const String &where, const Values &params, std::ostream &out);
+    /** Store \a size bytes read from the stream into a BLOB column
+     * of the only row selected by \a where.  Throws ShortBlobStream
+     * if the stream ends early, the value must be left unchanged then.
+     */
+    virtual void write_blob(const String &table, const String &column,
+            const String &where, const Values &params,
+            std::istream &in, LongInt size);
 };
 
 class YBORM_DECL SqlSource: public StringDict
@@ -212,6 +315,7 @@ class YBORM_DECL SqlResultSet: public ResultSetBase<Row>
     friend class SqlCursor;
     SqlCursor &cursor_;
     mutable std::auto_ptr<SqlCursor> owned_cursor_;
+    Values values_;
     bool fetch(Row &row);
     SqlResultSet(SqlCursor &cursor): cursor_(cursor) {}
 public:
@@ -220,6 +324,12 @@ public:
         , owned_cursor_(rs.owned_cursor_.release())
     {}
     void own(std::auto_ptr<SqlCursor> cursor);
+    /** Fetch the next row by position, bypassing the iterators.
+     * Don't mix the two ways of reading the same result set.
+     */
+    bool fetch_values(Values &values);
+    //! Column names, available after the first row has been fetched
+    const RowHeaderPtr &header() const;
 };
 
 class YBORM_DECL SqlCursor: NonCopyable
@@ -227,6 +337,8 @@ class YBORM_DECL SqlCursor: NonCopyable
     friend class SqlConnection;
     SqlConnection &connection_;
     std::auto_ptr<SqlCursorBackend> backend_;
+    String sql_;
+    RowHeaderPtr header_;
     bool echo_, conv_params_;
     ILogger *log_;
     void debug(const String &s, int level = ll_DEBUG)
@@ -235,19 +347,55 @@ class YBORM_DECL SqlCursor: NonCopyable
             log_->log(level, NARROW(s));
     }
     SqlCursor(SqlConnection &connection);
+    SqlCursorBackend *backend();
+    void release_stmt();
 public:
+    ~SqlCursor();
     void exec_direct(const String &sql);
     void prepare(const String &sql);
     void bind_params(const TypeCodes &types);
     SqlResultSet exec(const Values &params);
+    void exec_batch(const std::vector<Values> &params_rows);
+    bool fetch_values(Values &values);
+    const RowHeaderPtr &header() const { return header_; }
     RowPtr fetch_row();
     RowsPtr fetch_rows(int max_rows = -1); // -1 = all
+    bool last_insert_id(LongInt &id);
+    /** Read the value of a BLOB column of the only row selected
+     * by \a where into the stream, by chunks of YB_BLOB_CHUNK_SIZE
+     * if the driver can do so.  The filter takes the parameters
+     * as '?' markers.  Returns false for a NULL value, throws
+     * NoDataFound if there is no such row.
+     */
+    bool read_blob(const String &table, const String &column,
+            const String &where, const Values &params, std::ostream &out);
+    /** Store \a size bytes from the stream into a BLOB column the same
+     * way.  If the stream ends early ShortBlobStream is thrown, the
+     * value stays as it was and the connection can be used further.
+     * On any other error the caller has to roll the transaction back,
+     * the value may be partly written.
+     */
+    void write_blob(const String &table, const String &column,
+            const String &where, const Values &params,
+            std::istream &in, LongInt size);
 };
 
+#define YB_STMT_CACHE_SIZE 50
+//! Bytes of a BLOB value passed at once by SqlCursor::read_blob()
+#define YB_BLOB_CHUNK_SIZE 65536
+
 class YBORM_DECL SqlConnection: NonCopyable
 {
     friend class SqlPool;
     friend class SqlCursor;
+    typedef std::list<String> StmtLru;
+    struct CachedStmt {
+        // Owned by the cache
+        SqlCursorBackend *backend;
+        StmtLru::iterator lru_pos;
+    };
+    typedef std::map<String, CachedStmt> StmtCache;
+
     SqlSource source_;
     SqlDriver *driver_;
     SqlDialect *dialect_;
@@ -256,7 +404,14 @@ class YBORM_DECL SqlConnection: NonCopyable
     bool activity_, echo_, conv_params_, bad_, explicit_trans_started_;
     time_t free_since_;
     ILogger::Ptr log_;
+    StmtCache stmt_cache_;
+    // The most recently used statements go first
+    StmtLru stmt_lru_;
+    int stmt_cache_size_;
+    size_t stmt_cache_hits_, stmt_cache_misses_;
     void mark_bad(const std::exception &e);
+    SqlCursorBackend *take_stmt(const String &sql);
+    void put_stmt(const String &sql, SqlCursorBackend *backend);
 public:
     SqlConnection(const String &driver_name,
             const String &dialect_name, const String &db,
@@ -286,6 +441,15 @@ public:
     }
     bool bad() const { return bad_; }
     bool activity() const { return activity_; }
+    /** Set max number of prepared statements kept open for reuse,
+     * keyed by the SQL text.  Zero disables the cache.
+     */
+    void set_stmt_cache_size(int size);
+    int stmt_cache_size() const { return stmt_cache_size_; }
+    size_t stmt_cache_count() const { return stmt_cache_.size(); }
+    size_t stmt_cache_hits() const { return stmt_cache_hits_; }
+    size_t stmt_cache_misses() const { return stmt_cache_misses_; }
+    void clear_stmt_cache();
     bool explicit_trans_started() const { return explicit_trans_started_; }
     bool explicit_transaction_control() const;
     void begin_trans_if_necessary();
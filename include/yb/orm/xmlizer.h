@@ -34,6 +34,9 @@ YBORM_DECL ElementTree::ElementPtr deep_xmlize(Session &session,
 
 YBORM_DECL ElementTree::ElementPtr xmlize_row(const Row &row, const String &entry_name);
 
+YBORM_DECL ElementTree::ElementPtr xmlize_row(const Values &row,
+        const RowHeader &header, const String &entry_name);
+
 YBORM_DECL ElementTree::ElementPtr xmlize_rows(const Rows &rows,
         const String &entries_name, const String &entry_name);
 
@@ -0,0 +1,50 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#ifndef YB__UTIL__ARENA__INCLUDED
+#define YB__UTIL__ARENA__INCLUDED
+
+#include <stddef.h>
+#include <vector>
+#include "util_config.h"
+#include "utility.h"
+
+namespace Yb {
+
+#define YB_ARENA_BLOCK_SIZE 65536
+
+//! Monotonic memory arena with free lists of the released chunks
+/** Memory is carved from big blocks, which are returned to the heap
+ * only when the arena is destroyed.  The chunks deallocated
+ * before that are kept in free lists, by size, for reuse.
+ * The arena is reference counted, each chunk allocated with
+ * arena_new() holds a reference.  Not thread safe.
+ */
+class YBUTIL_DECL Arena: public RefCountBase, private NonCopyable
+{
+    std::vector<char *> blocks_;
+    std::vector<void *> free_lists_;
+    size_t block_size_, block_pos_;
+    size_t alloc_count_, reuse_count_;
+public:
+    explicit Arena(size_t block_size = YB_ARENA_BLOCK_SIZE);
+    ~Arena();
+    void *allocate(size_t size);
+    void deallocate(void *p, size_t size);
+    //! Number of blocks taken from the heap
+    size_t block_count() const { return blocks_.size(); }
+    //! Number of allocate() calls
+    size_t alloc_count() const { return alloc_count_; }
+    //! Number of allocations served from the free lists
+    size_t reuse_count() const { return reuse_count_; }
+};
+
+typedef IntrusivePtr<Arena> ArenaPtr;
+
+//! Allocate memory for an object from the arena, or from the heap if NULL
+YBUTIL_DECL void *arena_new(size_t size, Arena *arena);
+//! Free the memory allocated with arena_new(), size may be 0 if unknown
+YBUTIL_DECL void arena_delete(void *p, size_t size);
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
+#endif // YB__UTIL__ARENA__INCLUDED
@@ -13,43 +13,46 @@ namespace Yb {
 template <class RowType>
 class ResultSetBase
 {
-    std::deque<RowType> rows_;
-    bool finish_;
+    // The rows are fetched in place into these two buffers in turn,
+    // the other one keeps the row a postfix increment returns
+    RowType rows_[2];
+    int cur_;
+    bool ready_, finish_;
+    std::deque<RowType> loaded_;
 
     virtual bool fetch(RowType &row) = 0;
 
-    bool ready() const { return rows_.size() > 1; }
+    bool ready() const { return ready_; }
     RowType &get_current_row() {
-        YB_ASSERT(ready());
-        return rows_[1];
+        YB_ASSERT(ready_);
+        return rows_[cur_];
     }
     RowType &get_previous_row() {
-        YB_ASSERT(!rows_.empty());
-        return rows_[0];
+        return rows_[1 - cur_];
     }
     void step_forward() {
-        YB_ASSERT(!rows_.empty());
-        rows_.pop_front();
+        YB_ASSERT(ready_);
+        ready_ = false;
+        cur_ = 1 - cur_;
     }
     bool fetch_next() {
+        if (!loaded_.empty()) {
+            std::swap(rows_[cur_], loaded_.front());
+            loaded_.pop_front();
+            ready_ = true;
+            return true;
+        }
         if (finish_)
             return false;
-        RowType row;
-        finish_ = !fetch(row);
-        if (!finish_) {
-            if (rows_.empty()) {
-                RowType row0;
-                rows_.push_back(row0);
-            }
-            rows_.push_back(row);
-        }
-        return !finish_;
+        finish_ = !fetch(rows_[cur_]);
+        ready_ = !finish_;
+        return ready_;
     }
 public:
     class iterator;
     friend class iterator;
 
-    ResultSetBase(): finish_(false) {}
+    ResultSetBase(): cur_(0), ready_(false), finish_(false) {}
     virtual ~ResultSetBase() {}
 
     class iterator: public std::iterator<std::input_iterator_tag,
@@ -115,9 +118,14 @@ public:
 
     iterator begin() { return iterator(*this, false); }
     iterator end() { return iterator(*this, true); }
+    //! Fetch all the remaining rows at once
     void load() {
-        while (!finish_)
-            fetch_next();
+        while (!finish_) {
+            loaded_.push_back(RowType());
+            finish_ = !fetch(loaded_.back());
+            if (finish_)
+                loaded_.pop_back();
+        }
     }
 };
 
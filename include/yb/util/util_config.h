@@ -33,6 +33,11 @@
 #define YB_USE_STDTUPLE
 #endif
 
+#if defined(__GXX_EXPERIMENTAL_CXX0X__) || __cplusplus >= 201103L \
+    || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#define YB_USE_RVALUE_REFS
+#endif
+
 namespace Yb {
 
 #if defined(_MSC_VER) || defined(__BORLANDC__)
@@ -32,7 +32,9 @@ template <class T__> struct ValueTraits {};
 
 //! Variant data type for communication to the database layer
 /** Value class objects can hold NULL values.  Copying such objects
- * is cheap because of shared pointer.
+ * is cheap: numbers, Decimal and DateTime are kept inline, while
+ * strings and blobs are kept in shared immutable buffers, which are
+ * never changed in place.
  * Value class also supports casting to several strict types.
  *
  * @remark Value class should not be implemented upon boost::any because of massive
@@ -40,7 +42,6 @@ template <class T__> struct ValueTraits {};
  */
 class YBUTIL_DECL Value
 {
-    void init();
     void destroy();
     void assign(const Value &other);
 
@@ -59,6 +60,10 @@ public:
     Value(const Blob &x);
     Value(const Value &other);
     Value &operator=(const Value &other);
+#if defined(YB_USE_RVALUE_REFS)
+    Value(Value &&other);
+    Value &operator=(Value &&other);
+#endif
     ~Value();
     void swap(Value &other);
     void fix_type(int type);
@@ -94,7 +99,13 @@ public:
 
 private:
     int type_;
-    LongInt data_;
+    //! Numbers, inline Decimal or DateTime, or a shared buffer
+    union Data {
+        LongInt i_;
+        double f_;
+        void *p_;
+        char buf_[YB_MAX(sizeof(Decimal), sizeof(DateTime))];
+    } data_;
 };
 
 template <> struct ValueTraits<int> {
@@ -177,16 +188,22 @@ typedef const Values *RowDataPtr;
 typedef std::vector<RowDataPtr> RowsData;
 typedef std::vector<std::pair<const String *, Value> > ValueMap;
 
+//! Primary key value of a row
+/** The hash value is calculated once by key_hash() and cached,
+ * so the key must be reset() before it's filled in again.
+ */
 struct Key {
     const String *table;
     const String *id_name;
     LongInt id_value;
     bool id_is_null;
     ValueMap fields;
+    mutable size_t hash_value;
     Key(const String *_table = NULL, const String *_id_name = NULL,
             LongInt _id_value = 0, bool _id_is_null = false)
         : table(_table), id_name(_id_name)
         , id_value(_id_value), id_is_null(_id_is_null)
+        , hash_value(0)
     {}
     void reset(const String *_table, const String *_id_name = NULL,
                LongInt _id_value = 0, bool _id_is_null = false)
@@ -195,6 +212,7 @@ struct Key {
         id_name = _id_name;
         id_value = _id_value;
         id_is_null = _id_is_null;
+        hash_value = 0;
         if (fields.size())
             fields.clear();
     }
@@ -205,6 +223,7 @@ struct Key {
         std::swap(id_value, k.id_value);
         std::swap(id_is_null, k.id_is_null);
         std::swap(fields, k.fields);
+        std::swap(hash_value, k.hash_value);
     }
 };
 
@@ -219,6 +238,8 @@ inline bool operator <= (const Key &x, const Key &y) { return !(y < x); }
 inline bool operator >= (const Key &x, const Key &y) { return !(x < y); }
 
 YBUTIL_DECL bool empty_key(const Key &key);
+//! Hash value consistent with key_cmp(), never zero
+YBUTIL_DECL size_t key_hash(const Key &key);
 YBUTIL_DECL const String key2str(const Key &key);
 
 //! @name Casting from variant typed to certain type
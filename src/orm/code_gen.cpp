@@ -69,6 +69,7 @@ string type_nc_by_handle(int type)
         case Value::STRING:   return "Yb::String";
         case Value::DECIMAL:  return "Yb::Decimal";
         case Value::FLOAT:    return "double";
+        case Value::BLOB:     return "Yb::Blob";
         default:
             throw CodeGenError(_T("Unknown type while parsing metadata"));
     }
@@ -91,6 +92,8 @@ string flags_code_by_handle(int flags)
         code += "|Yb::Column::RO";
     if (flags & Column::NULLABLE)
         code += "|Yb::Column::NULLABLE";
+    if (flags & Column::LAZY)
+        code += "|Yb::Column::LAZY";
     if (code.empty())
         return "0";
     return code.substr(1);
@@ -255,8 +258,10 @@ void SqlTableGenerator::gen_typed_column(ostream &out,
     if (!str_empty(not_null_default_clause))
         out << " " << NARROW(not_null_default_clause);
     String autoinc_flag = dialect_->autoinc_flag();
+    // Where sequences exist, a table with one takes its keys from it
     if (column.is_pk()
-            && (table_.autoinc() || !str_empty(table_.seq_name()))
+            && (table_.autoinc() || (!str_empty(table_.seq_name())
+                    && !dialect_->has_sequences()))
             && !str_empty(autoinc_flag))
     {
         String pk_flag = dialect_->primary_key_flag();
@@ -691,6 +696,12 @@ void CppCodeGenerator::write_cpp_create_table_meta(ostream &out)
         << "\"), _T(\"" << xml_name << "\"), _T(\"" << class_name_ << "\")));\n";
     if (!str_empty(table_.seq_name()))
         out << "\tt->set_seq_name(_T(\"" << NARROW(table_.seq_name()) << "\"));\n";
+    if (!str_empty(table_.id_generator()))
+        out << "\tt->set_id_generator(_T(\"" << NARROW(table_.id_generator())
+            << "\"), " << table_.id_block() << ");\n";
+    if (table_.cached())
+        out << "\tt->set_cache(" << table_.cache_ttl() << ", "
+            << table_.cache_size() << ");\n";
     out << "\tc.fill_table(*t);\n"
         << "\ttbls.push_back(t);\n"
         << "}\n";
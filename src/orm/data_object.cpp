@@ -7,6 +7,8 @@
 
 #include "util/string_utils.h"
 #include "orm/data_object.h"
+#include "orm/object_cache.h"
+#include "orm/id_generator.h"
 #include <algorithm>
 #include <iostream>
 #if 0
@@ -60,45 +62,304 @@ DataObjectAlreadyInSession::DataObjectAlreadyInSession(
                   "in the identity map: ") + key2str(key))
 {}
 
-bool DataObjectResultSet::fetch(DataObjectList &row)
+ReadOnlySession::ReadOnlySession(const String &operation)
+    : ORMError(_T("Can't ") + operation + _T(" in a read-only session"))
+{}
+
+IdentityMap::TableSlots *IdentityMap::find_table(const String *table) const
+{
+    // There are few tables, the pointers are compared first
+    Tables::const_iterator i = tables_.begin(), iend = tables_.end();
+    for (; i != iend; ++i)
+        if (i->table == table)
+            return const_cast<TableSlots *>(&*i);
+    for (i = tables_.begin(); i != iend; ++i)
+        if (*i->table == *table)
+            return const_cast<TableSlots *>(&*i);
+    return NULL;
+}
+
+size_t IdentityMap::find_slot(const TableSlots &t, const Key &key, size_t hash)
+{
+    size_t mask = t.slots.size() - 1, pos = hash & mask;
+    while (true) {
+        const Slot &slot = t.slots[pos];
+        if (!slot.obj || (slot.hash == hash &&
+                    slot.obj->table().same_key(slot.obj->raw_values(), key)))
+            return pos;
+        pos = (pos + 1) & mask;
+    }
+}
+
+size_t IdentityMap::find_slot(const TableSlots &t, const DataObject *obj)
+{
+    size_t hash = obj->key_hash();
+    size_t mask = t.slots.size() - 1, pos = hash & mask;
+    while (true) {
+        const Slot &slot = t.slots[pos];
+        if (!slot.obj || slot.obj == obj || (slot.hash == hash &&
+                    obj->table().same_key(slot.obj->raw_values(),
+                        obj->raw_values())))
+            return pos;
+        pos = (pos + 1) & mask;
+    }
+}
+
+void IdentityMap::grow(TableSlots &t)
+{
+    Slots old_slots(t.slots.size()? t.slots.size() * 2: 16);
+    Slot empty_slot = { 0, NULL };
+    std::fill(old_slots.begin(), old_slots.end(), empty_slot);
+    t.slots.swap(old_slots);
+    size_t mask = t.slots.size() - 1;
+    Slots::const_iterator i = old_slots.begin(), iend = old_slots.end();
+    for (; i != iend; ++i)
+        if (i->obj) {
+            size_t pos = i->hash & mask;
+            while (t.slots[pos].obj)
+                pos = (pos + 1) & mask;
+            t.slots[pos] = *i;
+        }
+}
+
+DataObject *IdentityMap::find(const Key &key) const
+{
+    const TableSlots *t = find_table(key.table);
+    if (!t)
+        return NULL;
+    return t->slots[find_slot(*t, key, key_hash(key))].obj;
+}
+
+DataObject *IdentityMap::insert(DataObject *obj)
+{
+    const String *table = &obj->table().name();
+    TableSlots *t = find_table(table);
+    if (!t) {
+        TableSlots new_table;
+        new_table.table = table;
+        new_table.count = 0;
+        tables_.push_back(new_table);
+        t = &tables_.back();
+        grow(*t);
+    }
+    size_t pos = find_slot(*t, obj);
+    if (t->slots[pos].obj)
+        return t->slots[pos].obj;
+    if ((t->count + 1) * 10 > t->slots.size() * 7) {
+        grow(*t);
+        pos = find_slot(*t, obj);
+    }
+    t->slots[pos].hash = obj->key_hash();
+    t->slots[pos].obj = obj;
+    ++t->count;
+    ++size_;
+    return obj;
+}
+
+bool IdentityMap::erase(const Key &key, DataObject *obj)
 {
-    if (!it_.get())
-        it_.reset(new SqlResultSet::iterator(rs_.begin()));
-    if (rs_.end() == *it_)
+    TableSlots *t = find_table(key.table);
+    if (!t)
         return false;
-    DataObjectList new_row;
-    Row &cur = **it_;
+    size_t pos = find_slot(*t, key, key_hash(key));
+    if (!t->slots[pos].obj || (obj && t->slots[pos].obj != obj))
+        return false;
+    // Shift the following slots back, so no tombstones are needed
+    size_t mask = t->slots.size() - 1, next = pos;
+    while (true) {
+        next = (next + 1) & mask;
+        const Slot &slot = t->slots[next];
+        if (!slot.obj)
+            break;
+        size_t home = slot.hash & mask;
+        if (pos <= next? (pos < home && home <= next):
+                (pos < home || home <= next))
+            continue;
+        t->slots[pos] = slot;
+        pos = next;
+    }
+    t->slots[pos].obj = NULL;
+    --t->count;
+    --size_;
+    return true;
+}
+
+void IdentityMap::clear()
+{
+    Tables empty_tables;
+    tables_.swap(empty_tables);
+    size_ = 0;
+}
+
+void IdentityMap::swap(IdentityMap &other)
+{
+    tables_.swap(other.tables_);
+    std::swap(size_, other.size_);
+}
+
+const IdentityMap::Slots *IdentityMap::table_slots(const String *table) const
+{
+    const TableSlots *t = find_table(table);
+    return t? &t->slots: NULL;
+}
+
+size_t IdentityMap::slot_pos(DataObject *obj) const
+{
+    const TableSlots *t = find_table(&obj->table().name());
+    if (!t)
+        return (size_t)-1;
+    size_t pos = find_slot(*t, obj);
+    return t->slots[pos].obj == obj? pos: (size_t)-1;
+}
+
+bool DataObjectResultSet::fetch_objects(DataObjectList &row)
+{
+    if (!rs_.fetch_values(cur_))
+        return false;
+    ++n_rows_;
+    row.clear();
     size_t pos = 0;
     for (size_t i = 0; i < tables_.size(); ++i) {
         DataObject::Ptr d = DataObject::create_new
-            (*tables_[i], DataObject::Sync);
-        pos = d->fill_from_row(cur, pos);
-        DataObject::Ptr e = session_.save_or_update(d);
-        new_row.push_back(e);
+            (*tables_[i], DataObject::Sync, session_.arena());
+        pos = d->fill_from_row(cur_, pos);
+        // An outer joined table may have no matching row
+        if (i >= n_main_ && !d->assigned_key()) {
+            row.push_back(DataObject::Ptr(NULL));
+            continue;
+        }
+        // A stateless session doesn't keep the objects it loads
+        if (session_.stateless())
+            row.push_back(d);
+        else
+            row.push_back(session_.save_or_update(d));
     }
-    row.swap(new_row);
-    ++*it_;
+    return true;
+}
 
+void DataObjectResultSet::link_eager(DataObjectList &row)
+{
+    for (size_t i = 0; i < eager_.size(); ++i) {
+        DataObject::Ptr obj = row[eager_pos_[i]], other = row[n_main_ + i];
+        if (!shptr_get(obj) || !shptr_get(other))
+            continue;
+        if (other->status() == DataObject::ToBeDeleted ||
+                other->status() == DataObject::Deleted)
+            continue;
+        if (eager_[i].second == 1)
+            DataObject::link(shptr_get(obj), other, *eager_[i].first);
+        else
+            DataObject::link(shptr_get(other), obj, *eager_[i].first);
+    }
+}
+
+static bool same_objects(const DataObjectList &a, const DataObjectList &b,
+                         size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        if (shptr_get(a[i]) == shptr_get(b[i]))
+            continue;
+        // Without an identity map the same row gives distinct objects
+        if (!shptr_get(a[i]) || !shptr_get(b[i]) || a[i]->session() ||
+                &a[i]->table() != &b[i]->table() ||
+                !a[i]->table().same_key(a[i]->raw_values(),
+                    b[i]->raw_values()))
+            return false;
+    }
     return true;
 }
 
+static std::vector<DataObject *> main_objects(const DataObjectList &row)
+{
+    std::vector<DataObject *> objs(row.size());
+    for (size_t i = 0; i < row.size(); ++i)
+        objs[i] = shptr_get(row[i]);
+    return objs;
+}
+
+bool DataObjectResultSet::fetch(DataObjectList &row)
+{
+    if (!eager_.size())
+        return fetch_objects(row);
+    for (;;) {
+        if (!pending_.size() && !fetch_objects(pending_))
+            return false;
+        DataObjectList cur;
+        cur.swap(pending_);
+        link_eager(cur);
+        // Merge the following rows having the same leading objects
+        while (fetch_objects(pending_)) {
+            if (!same_objects(cur, pending_, n_main_))
+                break;
+            std::copy(cur.begin(), cur.begin() + n_main_, pending_.begin());
+            link_eager(pending_);
+            pending_.clear();
+        }
+        // The pager counts the joined rows, so the first collection
+        // may lack its head, and the last one its tail
+        bool cut = (first_group_ && offset_ > 0) ||
+            (!pending_.size() && limit_ > 0 && n_rows_ >= limit_);
+        first_group_ = false;
+        for (size_t i = 0; !cut && i < eager_.size(); ++i)
+            if (eager_[i].second == 1 && shptr_get(cur[eager_pos_[i]]))
+                cur[eager_pos_[i]]->get_slaves(*eager_[i].first)
+                    ->status(RelationObject::Sync);
+        cur.resize(n_main_);
+        // A stateless session relies on the rows being ordered instead
+        if (session_.stateless() || seen_.insert(main_objects(cur)).second) {
+            row.swap(cur);
+            return true;
+        }
+    }
+}
+
+void DataObjectResultSet::init_eager()
+{
+    YB_ASSERT(tables_.size() >= eager_.size());
+    n_main_ = tables_.size() - eager_.size();
+    for (size_t i = 0; i < eager_.size(); ++i) {
+        const Relation &r = *eager_[i].first;
+        const Table *tbl = &r.table(1 - eager_[i].second);
+        YB_ASSERT(tables_[n_main_ + i] == &r.table(eager_[i].second));
+        size_t pos = 0;
+        while (pos < n_main_ && tables_[pos] != tbl)
+            ++pos;
+        YB_ASSERT(pos < n_main_);
+        eager_pos_.push_back(pos);
+    }
+}
+
 DataObjectResultSet::DataObjectResultSet(const SqlResultSet &rs, Session &session,
-                                         const Strings &tables)
+                                         const Strings &tables,
+                                         const EagerRelations &eager,
+                                         int limit, int offset)
     : rs_(rs)
     , session_(session)
+    , eager_(eager)
+    , limit_(limit)
+    , offset_(offset)
+    , n_rows_(0)
+    , first_group_(true)
 {
     const Schema &schema = session.schema();
     Strings::const_iterator i = tables.begin(), iend = tables.end();
     for (; i != iend; ++i)
         tables_.push_back(&schema.table(*i));
+    init_eager();
 }
 
 DataObjectResultSet::DataObjectResultSet(const DataObjectResultSet &obj)
     : rs_(obj.rs_)
     , tables_(obj.tables_)
     , session_(obj.session_)
+    , eager_(obj.eager_)
+    , limit_(obj.limit_)
+    , offset_(obj.offset_)
+    , n_rows_(0)
+    , first_group_(true)
 {
-    YB_ASSERT(!obj.it_.get());
+    YB_ASSERT(!obj.rs_.header().get());
+    init_eager();
 }
 
 void Session::clone_engine(EngineSource *src_engine)
@@ -120,6 +381,8 @@ void Session::set_logger(ILogger::Ptr logger)
 
 Session::Session(const Schema &schema, EngineSource *engine)
     : schema_(schema)
+    , load_batch_size_(YB_LOAD_BATCH_SIZE)
+    , stateless_(false)
 {
     clone_engine(engine);
 }
@@ -130,6 +393,8 @@ Session::Session(const Schema &schema, const String &connection_url)
                 new Engine(Engine::READ_WRITE,
                     std::auto_ptr<SqlConnection>(
                         new SqlConnection(connection_url)))))
+    , load_batch_size_(YB_LOAD_BATCH_SIZE)
+    , stateless_(false)
 {
     clone_engine(created_engine_.get());
 }
@@ -142,12 +407,15 @@ Session::Session(const Schema &schema, const String &driver_name,
                     std::auto_ptr<SqlConnection>(
                         new SqlConnection(driver_name, dialect_name,
                             raw_connection)))))
+    , load_batch_size_(YB_LOAD_BATCH_SIZE)
+    , stateless_(false)
 {
     clone_engine(created_engine_.get());
 }
 
 Session::~Session() {
     try {
+        unlock_cache();
         clear();
     }
     catch (const std::exception &e) {
@@ -165,8 +433,12 @@ void Session::clear()
         (*i)->forget_session();
     Objects empty_objects;
     objects_.swap(empty_objects);
-    IdentityMap empty_map;
-    identity_map_.swap(empty_map);
+    identity_map_.clear();
+    new_objs_.clear();
+    dirty_objs_.clear();
+    to_delete_objs_.clear();
+    deleted_objs_.clear();
+    ghost_objs_.clear();
     if (engine_.get())
         engine_->rollback();
 }
@@ -174,20 +446,20 @@ void Session::clear()
 DataObject *Session::add_to_identity_map(DataObject *obj, bool return_found)
 {
     if (obj->assigned_key()) {
-        const Key &key = obj->key();
-        IdentityMap::iterator i = identity_map_.find(key);
-        if (i != identity_map_.end()) {
+        DataObject *found = identity_map_.insert(obj);
+        if (found != obj) {
             if (return_found)
-                return i->second;
+                return found;
             throw DataObjectAlreadyInSession(obj->key());
         }
-        identity_map_[key] = obj;
     }
     return obj;
 }
 
 void Session::save(DataObjectPtr obj0)
 {
+    if (stateless_)
+        throw ReadOnlySession(_T("save"));
     DataObject *obj = add_to_identity_map(shptr_get(obj0), true);
     if (obj == shptr_get(obj0)) {
         objects_.insert(obj0);
@@ -197,6 +469,8 @@ void Session::save(DataObjectPtr obj0)
 
 DataObjectPtr Session::save_or_update(DataObjectPtr obj0)
 {
+    if (stateless_)
+        throw ReadOnlySession(_T("save"));
     DataObject *obj = add_to_identity_map(shptr_get(obj0), true);
     if (obj == shptr_get(obj0)) {
         objects_.insert(obj0);
@@ -207,18 +481,18 @@ DataObjectPtr Session::save_or_update(DataObjectPtr obj0)
     for (size_t i = 0; i < table.size(); ++i)
         if (!table[i].is_pk())
             obj->values_[i] = obj0->values_[i];
-    obj->status_ = obj0->status_;
+    obj->set_status(obj0->status_);
+    if (obj0->dirty_.get())
+        obj->dirty_.reset(new DataObject::DirtyInfo(*obj0->dirty_));
+    else
+        obj->clear_dirty();
     return DataObjectPtr(obj);
 }
 
 void Session::detach(DataObjectPtr obj)
 {
-    if (obj->assigned_key()) {
-        const Key &key = obj->key();
-        IdentityMap::iterator i = identity_map_.find(key);
-        if (i != identity_map_.end())
-            identity_map_.erase(i);
-    }
+    if (obj->assigned_key())
+        identity_map_.erase(obj->key(), shptr_get(obj));
     Objects::iterator i = objects_.find(obj);
     if (i != objects_.end()) {
         objects_.erase(i);
@@ -246,28 +520,43 @@ DataObjectResultSet Session::load_collection(
         bool for_update_flag)
 {
     Strings tables;
-    SelectExpr select = make_select(
-        schema_, from, filter, order_by, for_update_flag, 0, 0, &tables);
-    return load_collection(tables, select);
+    SqlResultSet rs = engine_->select_iter(schema_, from, filter, order_by,
+            for_update_flag, 0, 0, tables);
+    return DataObjectResultSet(rs, *this, tables);
 }
 
 DataObjectResultSet Session::load_collection(
-        const Strings &tables, const SelectExpr &select_expr)
+        const Strings &tables, const SelectExpr &select_expr,
+        const EagerRelations &eager)
 {
     SqlResultSet rs = engine_->select_iter(select_expr);
-    return DataObjectResultSet(rs, *this, tables);
+    return DataObjectResultSet(rs, *this, tables, eager,
+            select_expr.pager_limit(), select_expr.pager_offset());
+}
+
+DataObjectResultSet Session::load_collection(
+        const Strings &tables, const Expression &from_where,
+        const Expression &filter, const Expression &order_by,
+        bool for_update_flag, int limit, int offset,
+        const EagerRelations &eager)
+{
+    Strings select_tables;
+    SqlResultSet rs = engine_->select_iter(schema_, from_where, filter,
+            order_by, for_update_flag, limit, offset, select_tables);
+    return DataObjectResultSet(rs, *this, tables, eager, limit, offset);
 }
 
 DataObject::Ptr Session::get_lazy(const Key &key)
 {
-    IdentityMap::iterator i = identity_map_.find(key);
-    if (i != identity_map_.end())
-        return DataObject::Ptr(i->second);
+    DataObject *found = identity_map_.find(key);
+    if (found)
+        return DataObject::Ptr(found);
     bool empty = empty_key(key);
     if (empty)
         return DataObject::Ptr(NULL);
     DataObjectPtr new_obj =
-        DataObject::create_new(schema_[*key.table], DataObject::Ghost);
+        DataObject::create_new(schema_[*key.table], DataObject::Ghost,
+                               arena());
     if (key.id_name) {
         if (!key.id_is_null)
             new_obj->set(*key.id_name, key.id_value);
@@ -279,27 +568,228 @@ DataObject::Ptr Session::get_lazy(const Key &key)
     }
     objects_.insert(new_obj);
     new_obj->set_session(this);
-    identity_map_[key] = shptr_get(new_obj);
+    identity_map_.insert(shptr_get(new_obj));
     return new_obj;
 }
 
-typedef std::map<String, Rows> RowsByTable;
-typedef std::map<String, RowsData> RowsDataByTable;
+template <class Pred>
+void Session::find_siblings(DataObject *obj, size_t max_count,
+                            Pred pred, std::vector<DataObject *> &out)
+{
+    // The identity map keeps the objects of each table together,
+    // so the slots are scanned starting right after obj, and only
+    // a few of them per sibling wanted, not to walk the whole table
+    // on each lazy load
+    const IdentityMap::Slots *slots =
+        identity_map_.table_slots(obj->key().table);
+    size_t pos = identity_map_.slot_pos(obj);
+    if (!slots || pos == (size_t)-1)
+        return;
+    size_t mask = slots->size() - 1;
+    size_t n_scan = std::min(slots->size() - 1,
+                             max_count * YB_SIBLINGS_SCAN);
+    for (size_t i = (pos + 1) & mask, n = 0;
+            out.size() < max_count && n < n_scan; i = (i + 1) & mask, ++n)
+    {
+        DataObject *sibling = (*slots)[i].obj;
+        if (sibling && pred(sibling))
+            out.push_back(sibling);
+    }
+}
+
+bool Session::load_from_cache(DataObject *obj)
+{
+    Values values;
+    if (!theObjectCache().get(cache_source(), obj->table(), obj->key(),
+                values) ||
+            values.size() != obj->values_.size())
+        return false;
+    obj->values_.swap(values);
+    obj->reset_key();
+    obj->set_status(DataObject::Sync);
+    return true;
+}
+
+const String &Session::cache_source()
+{
+    return engine_->get_conn()->get_source().id();
+}
+
+void Session::lock_in_cache(const Table &table, const Key &key)
+{
+    theObjectCache().lock(cache_source(), table, key);
+    cache_locks_.push_back(std::make_pair(&table, key));
+}
 
-template <class Row__, class Rows__>
-void add_row_to_rows_by_table(std::map<String, Rows__> &rows_by_table,
-                              const String &tbl_name, const Row__ &row)
+void Session::unlock_cache()
 {
-    typename std::map<String, Rows__>::iterator k = rows_by_table.find(tbl_name);
-    if (k == rows_by_table.end()) {
-        Rows__ rows(1);
-        rows[0] = row;
-        rows_by_table.insert(std::make_pair(tbl_name, rows));
+    if (!cache_locks_.size())
+        return;
+    const String &source = cache_source();
+    for (size_t i = 0; i < cache_locks_.size(); ++i)
+        theObjectCache().unlock(source, *cache_locks_[i].first,
+                                cache_locks_[i].second);
+    cache_locks_.clear();
+}
+
+void Session::load_ghosts(DataObject *obj)
+{
+    const Table &table = obj->table();
+    if (table.cached() && load_from_cache(obj))
+        return;
+    // The Ghost objects of the table are kept in a work list
+    std::vector<DataObject *> objs(1, obj);
+    size_t max_count = load_batch_size_ > 1? load_batch_size_: 1;
+    ObjectsByTable::const_iterator g = ghost_objs_.find(&table);
+    if (g != ghost_objs_.end()) {
+        ObjectSet::const_iterator i = g->second.begin(),
+            iend = g->second.end();
+        for (; i != iend && objs.size() < max_count; ++i)
+            if (*i != obj)
+                objs.push_back(*i);
     }
-    else {
-        Rows__ &rows = k->second;
-        rows.push_back(row);
+    Keys keys;
+    keys.reserve(objs.size());
+    for (size_t i = 0; i < objs.size(); ++i)
+        if (i == 0 || !table.cached() || !load_from_cache(objs[i]))
+            keys.push_back(objs[i]->key());
+    unsigned long stamp = table.cached()?
+        theObjectCache().stamp(cache_source(), table): 0;
+    ExpressionList cols;
+    add_object_columns(cols, table);
+    size_t key_size = keys[0].id_name? 1: keys[0].fields.size();
+    size_t chunk_size = engine_->get_dialect()->max_params() / key_size;
+    if (chunk_size < 1)
+        chunk_size = 1;
+    for (size_t start = 0; start < keys.size(); start += chunk_size) {
+        Keys chunk(keys.begin() + start,
+                   keys.begin() + std::min(keys.size(), start + chunk_size));
+        RowsPtr result = engine_->select
+            (cols, ColumnExpr(table.name()), KeysFilter(chunk));
+        Rows::iterator j = result->begin(), jend = result->end();
+        for (; j != jend; ++j) {
+            Values pk_values(table.size());
+            for (size_t k = 0; k < table.size(); ++k)
+                if (table[k].is_pk()) {
+                    pk_values[k] = (*j)[k].second;
+                    pk_values[k].fix_type(table[k].type());
+                }
+            Key row_key;
+            table.mk_key(pk_values, row_key);
+            DataObject *found = identity_map_.find(row_key);
+            if (found && found->status() == DataObject::Ghost) {
+                found->fill_from_row(*j);
+                theObjectCache().put(cache_source(), table, row_key,
+                        found->values_, stamp);
+            }
+        }
+    }
+    if (obj->status() == DataObject::Ghost)
+        throw ObjectNotFoundByKey(table.name() + _T("(")
+                                  + KeyFilter(keys[0]).get_sql() + _T(")"));
+}
+
+struct HasIncompleteSlaves
+{
+    const Relation *rel_;
+    HasIncompleteSlaves(const Relation &rel): rel_(&rel) {}
+    bool operator() (DataObject *obj) const {
+        if (obj->status() == DataObject::New ||
+                obj->status() == DataObject::ToBeDeleted ||
+                obj->status() == DataObject::Deleted)
+            return false;
+        DataObject::MasterRelations::iterator i =
+            obj->master_relations().find(rel_);
+        return i == obj->master_relations().end() ||
+            i->second->status() == RelationObject::Incomplete;
     }
+};
+
+// Make the foreign key value, as RelationObject::gen_fkey() does,
+// from the slave columns of a fetched row
+static const Key row_fkey(const Relation &r, const Values &row)
+{
+    const Table &master_tbl = r.table(0), &slave_tbl = r.table(1);
+    const Strings &parts = r.fk_fields();
+    Key fkey;
+    if (master_tbl.pk_fields().size() == 1) {
+        const String &pk_name = master_tbl.pk_fields()[0];
+        int col_type = master_tbl.column(pk_name).type();
+        if (col_type == Value::INTEGER || col_type == Value::LONGINT) {
+            const Value &x = row[slave_tbl.idx_by_name(parts[0])];
+            fkey.reset(&slave_tbl.name(), &parts[0],
+                       x.is_null()? 0: x.as_longint(), x.is_null());
+            return fkey;
+        }
+    }
+    fkey.reset(&slave_tbl.name());
+    fkey.fields.reserve(master_tbl.pk_fields().size());
+    Strings::const_iterator i = parts.begin(), iend = parts.end(),
+        j = master_tbl.pk_fields().begin(),
+        jend = master_tbl.pk_fields().end();
+    for (; i != iend && j != jend; ++i, ++j) {
+        Value x = row[slave_tbl.idx_by_name(*i)];
+        x.fix_type(master_tbl.column(*j).type());
+        fkey.fields.push_back(std::make_pair(&*i, x));
+    }
+    return fkey;
+}
+
+void Session::load_slaves(RelationObject *ro)
+{
+    const Relation &rel = ro->relation_info();
+    const Table &slave_tbl = rel.table(1);
+    DataObject *master = ro->master_object();
+    std::vector<DataObject *> masters;
+    find_siblings(master, load_batch_size_ > 1? load_batch_size_ - 1: 0,
+                  HasIncompleteSlaves(rel), masters);
+    typedef std::map<Key, RelationObject *> RelationsByFKey;
+    RelationsByFKey ros;
+    Keys fkeys;
+    fkeys.reserve(masters.size() + 1);
+    fkeys.push_back(ro->gen_fkey());
+    ros[fkeys.back()] = ro;
+    for (size_t i = 0; i < masters.size(); ++i) {
+        RelationObject *sibling = masters[i]->get_slaves(rel);
+        fkeys.push_back(sibling->gen_fkey());
+        ros[fkeys.back()] = sibling;
+    }
+    ExpressionList cols;
+    add_object_columns(cols, slave_tbl);
+    size_t key_size = fkeys[0].id_name? 1: fkeys[0].fields.size();
+    size_t chunk_size = engine_->get_dialect()->max_params() / key_size;
+    if (chunk_size < 1)
+        chunk_size = 1;
+    for (size_t start = 0; start < fkeys.size(); start += chunk_size) {
+        Keys chunk(fkeys.begin() + start,
+                   fkeys.begin() + std::min(fkeys.size(), start + chunk_size));
+        SelectExpr select_expr = SelectExpr(cols)
+            .from_(ColumnExpr(slave_tbl.name()))
+            .where_(KeysFilter(chunk));
+        if (rel.has_attr(1, _T("order-by")) &&
+                !str_empty(rel.attr(1, _T("order-by"))))
+            select_expr.order_by_(
+                    Expression(rel.attr(1, _T("order-by"))));
+        select_expr.add_aliases();
+        SqlResultSet rs = engine_->select_iter(select_expr);
+        Values k;
+        while (rs.fetch_values(k)) {
+            RelationsByFKey::iterator q = ros.find(row_fkey(rel, k));
+            if (q == ros.end())
+                continue;
+            Key pkey;
+            slave_tbl.mk_key(k, pkey);
+            DataObject::Ptr o = get_lazy(pkey);
+            if (o->status() == DataObject::Ghost)
+                o->fill_from_row(k);
+            if (o->status() != DataObject::ToBeDeleted
+                    && o->status() != DataObject::Deleted)
+                DataObject::link(q->second->master_object(), o, rel);
+        }
+    }
+    RelationsByFKey::iterator q = ros.begin(), qend = ros.end();
+    for (; q != qend; ++q)
+        q->second->status(RelationObject::Sync);
 }
 
 void Session::flush_tbl_new_keyed(const Table &tbl, Objects &keyed_objs)
@@ -328,15 +818,21 @@ void Session::flush_tbl_new_keyed(const Table &tbl, Objects &keyed_objs)
 
 void Session::flush_tbl_new_unkeyed(const Table &tbl, Objects &unkeyed_objs)
 {
-    bool sql_seq = engine_->get_dialect()->has_sequences();
+    SqlDialect *dialect = engine_->get_dialect();
+    bool sql_seq = dialect->has_sequences();
     bool use_seq = sql_seq && !str_empty(tbl.seq_name());
-    bool use_autoinc = !sql_seq &&
-        (tbl.autoinc() || !str_empty(tbl.seq_name()));
+    // With sequences, an autoinc table having none needs the INSERT
+    // to return its keys
+    bool use_autoinc = !sql_seq?
+        (tbl.autoinc() || !str_empty(tbl.seq_name())):
+        (!use_seq && tbl.autoinc() &&
+         dialect->returning_model() != RETURNING_NONE);
     Objects::iterator i, iend = unkeyed_objs.end();
     if (use_seq) {
         String pk = tbl.get_surrogate_pk();
+        IdGenerator &gen = table_id_generator(tbl, *engine_);
         for (i = unkeyed_objs.begin(); i != iend; ++i)
-            (*i)->set(pk, Value(engine_->get_next_value(tbl.seq_name())));
+            (*i)->set(pk, Value(gen.next_id(*engine_)));
     }
     RowsData rows;
     rows.reserve(unkeyed_objs.size());
@@ -359,121 +855,151 @@ void Session::flush_tbl_new_unkeyed(const Table &tbl, Objects &unkeyed_objs)
     }
 }
 
+Session::ObjectsByTable *Session::work_list(int status)
+{
+    switch (status) {
+    case DataObject::New:
+        return &new_objs_;
+    case DataObject::Ghost:
+        return &ghost_objs_;
+    case DataObject::Dirty:
+        return &dirty_objs_;
+    case DataObject::ToBeDeleted:
+        return &to_delete_objs_;
+    case DataObject::Deleted:
+        return &deleted_objs_;
+    }
+    return NULL;
+}
+
+void Session::status_changed(DataObject *obj, int old_status, int new_status)
+{
+    ObjectsByTable *objs = work_list(old_status);
+    if (objs) {
+        ObjectsByTable::iterator i = objs->find(&obj->table());
+        if (i != objs->end()) {
+            i->second.erase(obj);
+            if (i->second.empty())
+                objs->erase(i);
+        }
+    }
+    objs = work_list(new_status);
+    if (objs)
+        (*objs)[&obj->table()].insert(obj);
+}
+
 void Session::flush_new()
 {
-    SqlDialect *dialect = engine_->get_dialect();
-    bool sql_seq = dialect->has_sequences();
-    Objects::iterator i = objects_.begin(), iend = objects_.end();
-    for (; i != iend; ++i)
-        if ((*i)->status() == DataObject::New)
+    // The work list is modified while the objects are flushed
+    ObjectsByTable new_objs = new_objs_;
+    ObjectsByTable::iterator j, jend = new_objs.end();
+    ObjectSet::iterator i, iend;
+    for (j = new_objs.begin(); j != jend; ++j)
+        for (i = j->second.begin(), iend = j->second.end(); i != iend; ++i)
             (*i)->depth(-1);
-    for (i = objects_.begin(); i != iend; ++i)
-        if ((*i)->status() == DataObject::New)
+    for (j = new_objs.begin(); j != jend; ++j)
+        for (i = j->second.begin(), iend = j->second.end(); i != iend; ++i)
             (*i)->calc_depth(0);
     int max_depth = -1;
-    typedef std::map<String, Objects> ObjectsByTable;
     typedef std::map<int, ObjectsByTable> GroupsByDepth;
     GroupsByDepth groups_by_depth;
-    for (i = objects_.begin(); i != iend; ++i)
-        if ((*i)->status() == DataObject::New)
+    for (j = new_objs.begin(); j != jend; ++j)
+        for (i = j->second.begin(), iend = j->second.end(); i != iend; ++i)
     {
         int d = (*i)->depth();
         if (d > max_depth)
             max_depth = d;
-        GroupsByDepth::iterator k = groups_by_depth.find(d);
-        if (groups_by_depth.end() == k) {
-            std::pair<GroupsByDepth::iterator, bool> res =
-                groups_by_depth.insert(std::make_pair(
-                            d, ObjectsByTable()));
-            k = res.first;
-        }
-        ObjectsByTable &objs_by_table = k->second;
-        const String &tbl_name = (*i)->table().name();
-        ObjectsByTable::iterator q = objs_by_table.find(tbl_name);
-        if (objs_by_table.end() == q) {
-            std::pair<ObjectsByTable::iterator, bool> res =
-                objs_by_table.insert(std::make_pair(
-                            tbl_name, Objects()));
-            q = res.first;
-        }
-        Objects &objs = q->second;
-        objs.insert(*i);
+        groups_by_depth[d][j->first].insert(*i);
     }
     for (int d = 0; d <= max_depth; ++d) {
         GroupsByDepth::iterator k = groups_by_depth.find(d);
         if (k == groups_by_depth.end())
             continue;
         ObjectsByTable &objs_by_table = k->second;
-        ObjectsByTable::iterator j = objs_by_table.begin(), jend = objs_by_table.end();
-        for (; j != jend; ++j) {
-            const Table &tbl = schema_[j->first];
-            Objects &objs = j->second, unkeyed_objs, keyed_objs;
-            Objects::iterator l, lend = objs.end();
+        ObjectsByTable::iterator q = objs_by_table.begin(),
+            qend = objs_by_table.end();
+        for (; q != qend; ++q) {
+            const Table &tbl = *q->first;
+            ObjectSet &objs = q->second;
+            Objects unkeyed_objs, keyed_objs;
+            ObjectSet::iterator l, lend = objs.end();
             for (l = objs.begin(); l != lend; ++l) {
                 if ((*l)->assigned_key())
-                    keyed_objs.insert(*l);
+                    keyed_objs.insert(DataObjectPtr(*l));
                 else
-                    unkeyed_objs.insert(*l);
+                    unkeyed_objs.insert(DataObjectPtr(*l));
             }
             flush_tbl_new_keyed(tbl, keyed_objs);
             flush_tbl_new_unkeyed(tbl, unkeyed_objs);
         }
     }
-    for (i = objects_.begin(); i != iend; ++i)
-        if ((*i)->status() == DataObject::New)
-            (*i)->set_status(DataObject::Ghost);
+    for (j = new_objs.begin(); j != jend; ++j)
+        for (i = j->second.begin(), iend = j->second.end(); i != iend; ++i)
+            if ((*i)->status() == DataObject::New)
+                (*i)->set_status(DataObject::Ghost);
 }
 
-void Session::flush_update(IdentityMap &idmap_copy)
+void Session::flush_update()
 {
-    RowsDataByTable rows_by_table;
-    IdentityMap::iterator i = idmap_copy.begin(), iend = idmap_copy.end();
-    for (; i != iend; ++i)
-        if (i->second->status() == DataObject::Dirty) {
-            const String &tbl_name = i->second->table().name();
-            i->second->refresh_master_fkeys();
-            add_row_to_rows_by_table(rows_by_table, tbl_name,
-                                     &i->second->raw_values());
-            i->second->set_status(DataObject::Ghost);
+    // Objects having the same set of changed columns
+    // are updated with the same statement
+    typedef std::pair<const Table *, DataObject::DirtyColumns> UpdateGroup;
+    typedef std::map<UpdateGroup, RowsData> RowsDataByGroup;
+    RowsDataByGroup rows_by_group;
+    // Refreshing the foreign keys may make more objects dirty
+    while (!dirty_objs_.empty()) {
+        ObjectsByTable dirty_objs = dirty_objs_;
+        ObjectsByTable::iterator j = dirty_objs.begin(),
+            jend = dirty_objs.end();
+        for (; j != jend; ++j) {
+            ObjectSet::iterator i = j->second.begin(),
+                iend = j->second.end();
+            for (; i != iend; ++i) {
+                if ((*i)->status() != DataObject::Dirty)
+                    continue;
+                (*i)->refresh_master_fkeys();
+                if ((*i)->status() != DataObject::Dirty)
+                    continue;
+                UpdateGroup group(j->first, (*i)->dirty_columns());
+                rows_by_group[group].push_back(&(*i)->raw_values());
+                (*i)->set_status(DataObject::Ghost);
+                if (j->first->cached())
+                    lock_in_cache(*j->first, (*i)->key());
+            }
         }
-    RowsDataByTable::iterator j = rows_by_table.begin(), jend = rows_by_table.end();
-    for (; j != jend; ++j)
-        engine_->update(schema_[j->first], j->second);
+    }
+    RowsDataByGroup::iterator j = rows_by_group.begin(),
+        jend = rows_by_group.end();
+    for (; j != jend; ++j) {
+        // An object made Dirty without any tracked changes,
+        // e.g. created so, gets all of its columns updated
+        const DataObject::DirtyColumns &cols = j->first.second;
+        engine_->update(*j->first.first, j->second,
+                cols.empty()? NULL: &cols);
+    }
 }
 
-void Session::flush_delete(IdentityMap &idmap_copy)
+void Session::flush_delete()
 {
     typedef std::vector<Key> Keys;
-    typedef std::map<String, Keys> KeysByTable;
+    typedef std::map<const Table *, Keys> KeysByTable;
     typedef std::map<int, KeysByTable> GroupsByDepth;
     int max_depth = -1;
     GroupsByDepth groups_by_depth;
-    IdentityMap::iterator i = idmap_copy.begin(), iend = idmap_copy.end();
-    for (; i != iend; ++i)
-        if (i->second->status() == DataObject::ToBeDeleted)
-    {
-        int d = i->second->depth();
-        if (d > max_depth)
-            max_depth = d;
-        GroupsByDepth::iterator k = groups_by_depth.find(d);
-        if (groups_by_depth.end() == k) {
-            std::pair<GroupsByDepth::iterator, bool> res =
-                groups_by_depth.insert(std::make_pair(
-                            d, KeysByTable()));
-            k = res.first;
-        }
-        KeysByTable &keys_by_table = k->second;
-        const String &tbl_name = i->second->table().name();
-        KeysByTable::iterator q = keys_by_table.find(tbl_name);
-        if (keys_by_table.end() == q) {
-            std::pair<KeysByTable::iterator, bool> res =
-                keys_by_table.insert(std::make_pair(
-                            tbl_name, Keys()));
-            q = res.first;
+    ObjectsByTable to_delete_objs = to_delete_objs_;
+    ObjectsByTable::iterator j = to_delete_objs.begin(),
+        jend = to_delete_objs.end();
+    for (; j != jend; ++j) {
+        ObjectSet::iterator i = j->second.begin(), iend = j->second.end();
+        for (; i != iend; ++i) {
+            int d = (*i)->depth();
+            if (d > max_depth)
+                max_depth = d;
+            groups_by_depth[d][j->first].push_back((*i)->key());
+            (*i)->set_status(DataObject::Deleted);
+            if (j->first->cached())
+                lock_in_cache(*j->first, (*i)->key());
         }
-        Keys &keys = q->second;
-        keys.push_back(i->second->key());
-        i->second->set_status(DataObject::Deleted);
     }
 
     for (int d = max_depth; d >= 0; --d) {
@@ -485,30 +1011,40 @@ void Session::flush_delete(IdentityMap &idmap_copy)
         KeysByTable::iterator j = keys_by_table.begin(),
             jend = keys_by_table.end();
         for (; j != jend; ++j) {
-            debug(_T("flush_delete: table: ") + j->first);
-            engine_->delete_from(schema_[j->first], j->second);
+            debug(_T("flush_delete: table: ") + j->first->name());
+            engine_->delete_from(*j->first, j->second);
+        }
+    }
+}
+
+void Session::purge_deleted()
+{
+    ObjectsByTable deleted_objs;
+    deleted_objs.swap(deleted_objs_);
+    ObjectsByTable::iterator j = deleted_objs.begin(),
+        jend = deleted_objs.end();
+    for (; j != jend; ++j) {
+        ObjectSet::iterator i = j->second.begin(), iend = j->second.end();
+        for (; i != iend; ++i) {
+            if ((*i)->assigned_key())
+                identity_map_.erase((*i)->key(), *i);
+            objects_.erase(DataObjectPtr(*i));
         }
     }
 }
 
 void Session::flush()
 {
+    if (stateless_ && (new_objs_.size() || dirty_objs_.size() ||
+                       to_delete_objs_.size()))
+        throw ReadOnlySession(_T("flush"));
     debug(_T("flush started"));
     try {
-        IdentityMap idmap_copy = identity_map_;
         flush_new();
-        flush_update(idmap_copy);
-        flush_delete(idmap_copy);
+        flush_update();
+        flush_delete();
         // Delete the deleted objects
-        Objects obj_copy = objects_;
-        Objects::iterator i = obj_copy.begin(), iend = obj_copy.end();
-        for (; i != iend; ++i)
-            if ((*i)->status() == DataObject::Deleted) {
-                IdentityMap::iterator k = identity_map_.find((*i)->key());
-                if (k != identity_map_.end())
-                    identity_map_.erase(k);
-                objects_.erase(objects_.find(*i));
-            }
+        purge_deleted();
         debug(_T("flush finished OK"));
     }
     catch (...) {
@@ -521,30 +1057,81 @@ void Session::commit()
 {
     flush();
     engine_->commit();
+    unlock_cache();
 }
 
 void Session::rollback()
 {
     //purge();
     engine_->rollback();
+    unlock_cache();
 }
 
 void DataObject::set_session(Session *session)
 {
     YB_ASSERT(session && (!session_ || session_ == session));
-    session_ = session;
+    if (!session_) {
+        session_ = session;
+        session_->status_changed(this, -1, status_);
+    }
 }
 
 void DataObject::forget_session()
 {
     YB_ASSERT(session_);
+    session_->status_changed(this, status_, -1);
     session_ = NULL;
 }
 
 void DataObject::touch()
 {
-    if (status_ == Sync)
-        status_ = Dirty;
+    if (status_ == Sync || status_ == Dirty) {
+        // The columns to update are unknown, write them all,
+        // but a lazy one only if it has been set
+        if (!dirty_.get()) {
+            dirty_.reset(new DirtyInfo);
+            dirty_->cols.resize(values_.size());
+        }
+        for (size_t i = 0; i < values_.size(); ++i)
+            if (!table_[i].is_lazy())
+                dirty_->cols[i] = true;
+        Values empty_values;
+        dirty_->orig_values.swap(empty_values);
+        set_status(Dirty);
+    }
+}
+
+void DataObject::set_dirty(int i, Value &old_value)
+{
+    if (status_ != Sync && status_ != Dirty)
+        return;
+    if (!dirty_.get()) {
+        dirty_.reset(new DirtyInfo);
+        dirty_->cols.resize(values_.size());
+        // Made Dirty with no changes tracked, e.g. created so,
+        // then the other columns are written as well
+        if (status_ == Dirty)
+            for (size_t j = 0; j < values_.size(); ++j)
+                if (!table_[j].is_lazy())
+                    dirty_->cols[j] = true;
+    }
+    DirtyColumns &cols = dirty_->cols;
+    Values &orig_values = dirty_->orig_values;
+    if (!cols[i]) {
+        if (status_ == Sync && !orig_values.size())
+            orig_values.resize(values_.size());
+        if (orig_values.size())
+            orig_values[i].swap(old_value);
+        cols[i] = true;
+        set_status(Dirty);
+    }
+    else if (orig_values.size() && orig_values[i] == values_[i]) {
+        // The value has been reverted to the loaded one
+        cols[i] = false;
+        orig_values[i] = Value();
+        if (std::find(cols.begin(), cols.end(), true) == cols.end())
+            set_status(Sync);
+    }
 }
 
 void DataObject::set(int i, const Value &v)
@@ -569,45 +1156,84 @@ void DataObject::set(int i, const Value &v)
             throw StringTooLong(table_.name(), c.name(), c.size(), s);
     }
     values_[i].swap(new_v);
-    if (c.is_pk())
-        update_key();
+    if (!c.is_pk())
+        set_dirty(i, new_v);
     else
-        touch();
+        reset_key();
 }
 
-void DataObject::update_key()
+const DataObject::DirtyColumns &DataObject::dirty_columns() const
 {
-    assigned_key_ = table_.mk_key(values_, key_);
+    static const DirtyColumns no_columns;
+    return dirty_.get()? dirty_->cols: no_columns;
 }
 
-const Key &DataObject::key()
+const Key DataObject::key() const
 {
-    if (!key_.table)
-        update_key();
-    return key_;
+    Key key;
+    table_.mk_key(values_, key);
+    return key;
 }
 
-bool DataObject::assigned_key()
+size_t DataObject::key_hash() const
 {
-    if (!key_.table)
-        update_key();
-    return assigned_key_;
+    if (!key_hash_)
+        key_hash_ = Yb::key_hash(key());
+    return key_hash_;
+}
+
+bool DataObject::assigned_key() const
+{
+    const std::vector<int> &pk_idx = table_.pk_indices();
+    for (size_t i = 0; i < pk_idx.size(); ++i)
+        if (values_[pk_idx[i]].is_null())
+            return false;
+    return true;
+}
+
+BlobStream DataObject::blob_stream(int i)
+{
+    YB_ASSERT(i >= 0 && i < (int)values_.size());
+    return BlobStream(DataObjectPtr(this), i);
+}
+
+BlobStream DataObject::blob_stream(const String &name)
+{
+    return blob_stream(table_.idx_by_name(name));
+}
+
+const Key BlobStream::key_for_stream()
+{
+    Session *session = obj_->session();
+    YB_ASSERT(session != NULL);
+    if (obj_->status() == DataObject::New)
+        session->flush();
+    return obj_->key();
+}
+
+bool BlobStream::read(std::ostream &out)
+{
+    const Key key = key_for_stream();
+    const Table &table = obj_->table();
+    return obj_->session()->engine()->read_blob(
+            table, table[col_].name(), key, out);
+}
+
+void BlobStream::write(std::istream &in, LongInt size)
+{
+    Session *session = obj_->session();
+    YB_ASSERT(session != NULL);
+    if (session->stateless())
+        throw ReadOnlySession(_T("write a BLOB"));
+    const Key key = key_for_stream();
+    const Table &table = obj_->table();
+    session->engine()->write_blob(table, table[col_].name(), key, in, size);
 }
 
 void DataObject::load()
 {
     YB_ASSERT(session_ != NULL);
-    ExpressionList cols;
-    Columns::const_iterator it = table_.begin(), end = table_.end();
-    for (; it != end; ++it)
-        cols << ColumnExpr(table_.name(), it->name());
-    KeyFilter f(key());
-    RowsPtr result = session_->engine()->select
-        (cols, ColumnExpr(table_.name()), f);
-    if (result->size() != 1)
-        throw ObjectNotFoundByKey(table_.name() + _T("(")
-                                  + f.get_sql() + _T(")"));
-    fill_from_row(*result->begin());
+    session_->load_ghosts(this);
 }
 
 void DataObject::calc_depth(int d, DataObject *parent)
@@ -789,13 +1415,25 @@ DataObject::~DataObject()
 
 size_t DataObject::fill_from_row(Row &r, size_t pos)
 {
+    reset_key();
     size_t i = 0;
     for (; i < table_.size(); ++i) {
         values_[i].swap(r[pos + i].second);
         values_[i].fix_type(table_[i].type());
     }
-    update_key();
-    status_ = Sync;
+    set_status(Sync);
+    return pos + i;
+}
+
+size_t DataObject::fill_from_row(Values &r, size_t pos)
+{
+    reset_key();
+    size_t i = 0;
+    for (; i < table_.size(); ++i) {
+        values_[i].swap(r[pos + i]);
+        values_[i].fix_type(table_[i].type());
+    }
+    set_status(Sync);
     return pos + i;
 }
 
@@ -836,11 +1474,11 @@ void DataObject::delete_object(DeletionMode mode, int depth)
         delete_master_relations(DelUnchecked, depth + 1);
         exclude_from_slave_relations();
         if (status_ == New) {
-            status_ = Deleted;
+            set_status(Deleted);
         }
         else {
             //depth_ = depth; // why the hell I did that?
-            status_ = ToBeDeleted;
+            set_status(ToBeDeleted);
         }
     }
 }
@@ -1012,34 +1650,7 @@ void RelationObject::lazy_load_slaves()
     if (status_ != Incomplete)
         return;
     YB_ASSERT(master_object_->session());
-    Session &session = *master_object_->session();
-    const Table &master_tbl = relation_info_.table(0),
-        &slave_tbl = relation_info_.table(1);
-    ExpressionList cols;
-    Columns::const_iterator j = slave_tbl.begin(), jend = slave_tbl.end();
-    for (; j != jend; ++j)
-        cols << ColumnExpr(slave_tbl.name(), j->name());
-    SelectExpr select_expr = SelectExpr(cols)
-        .from_(ColumnExpr(slave_tbl.name()))
-        .where_(KeyFilter(gen_fkey()));
-    if (relation_info_.has_attr(1, _T("order-by")) &&
-            !str_empty(relation_info_.attr(1, _T("order-by"))))
-        select_expr.order_by_(
-                Expression(relation_info_.attr(1, _T("order-by"))));
-    select_expr.add_aliases();
-    SqlResultSet rs = session.engine()->select_iter(select_expr);
-    SqlResultSet::iterator k = rs.begin(), kend = rs.end();
-    for (; k != kend; ++k) {
-        Key pkey;
-        bool assigned_key = slave_tbl.mk_key(*k, pkey);
-        DataObject::Ptr o = session.get_lazy(pkey);
-        if (o->status() == DataObject::Ghost)
-            o->fill_from_row(*k);
-        if (o->status() != DataObject::ToBeDeleted
-                && o->status() != DataObject::Deleted)
-            DataObject::link(master_object_, o, relation_info_);
-    }
-    status_ = Sync;
+    master_object_->session()->load_slaves(this);
 }
 
 void RelationObject::refresh_slaves_fkeys()
@@ -49,6 +49,7 @@ InterbaseDialect::type2sql(int t)
         case Value::DECIMAL:    return _T("DECIMAL(16, 6)"); break;
         case Value::DATETIME:   return _T("TIMESTAMP");     break;
         case Value::FLOAT:      return _T("DOUBLE PRECISION"); break;
+        case Value::BLOB:       return _T("BLOB SUB_TYPE 0"); break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -70,6 +71,12 @@ InterbaseDialect::pager_model()
     return (int)PAGER_INTERBASE;
 }
 
+int
+InterbaseDialect::max_params()
+{
+    return 1500;
+}
+
 // schema introspection
 
 bool
@@ -57,6 +57,7 @@ MssqlDialect::type2sql(int t)
         case Value::DECIMAL:    return _T("DECIMAL(16, 6)"); break;
         case Value::DATETIME:   return _T("DATETIME");      break;
         case Value::FLOAT:      return _T("FLOAT"); break;
+        case Value::BLOB:       return _T("VARBINARY(MAX)"); break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -97,6 +98,25 @@ MssqlDialect::pager_model()
     return (int)PAGER_ORACLE;
 }
 
+int
+MssqlDialect::max_params()
+{
+    return 2000;
+}
+
+int
+MssqlDialect::insert_model()
+{
+    return (int)INSERT_VALUES_LIST;
+}
+
+int
+MssqlDialect::returning_model()
+{
+    // A plain OUTPUT clause fails on a table with an enabled trigger
+    return (int)RETURNING_OUTPUT_INTO;
+}
+
 // schema introspection
 
 bool
@@ -50,6 +50,7 @@ MysqlDialect::type2sql(int t)
         case Value::DECIMAL:    return _T("DECIMAL(16,6)"); break;
         case Value::DATETIME:   return _T("TIMESTAMP");     break;
         case Value::FLOAT:      return _T("DOUBLE"); break;
+        case Value::BLOB:       return _T("LONGBLOB"); break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -101,6 +102,18 @@ MysqlDialect::pager_model()
     return (int)PAGER_MYSQL;
 }
 
+int
+MysqlDialect::max_params()
+{
+    return 65535;
+}
+
+int
+MysqlDialect::insert_model()
+{
+    return (int)INSERT_VALUES_LIST;
+}
+
 // schema introspection
 
 bool
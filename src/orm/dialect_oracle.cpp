@@ -44,6 +44,7 @@ OracleDialect::type2sql(int t) {
         case Value::DATETIME:   return _T("DATE");      break;
         case Value::FLOAT:
         case Value::DECIMAL:    return _T("NUMBER");    break;
+        case Value::BLOB:       return _T("BLOB");      break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -72,6 +73,12 @@ OracleDialect::pager_model()
     return (int)PAGER_ORACLE;
 }
 
+int
+OracleDialect::insert_model()
+{
+    return (int)INSERT_ALL;
+}
+
 // schema introspection
 
 bool
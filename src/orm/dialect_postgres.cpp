@@ -45,6 +45,7 @@ PostgresDialect::type2sql(int t)
         case Value::DECIMAL:    return _T("NUMERIC");       break;
         case Value::DATETIME:   return _T("TIMESTAMP");     break;
         case Value::FLOAT:      return _T("DOUBLE PRECISION"); break;
+        case Value::BLOB:       return _T("BYTEA");         break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -59,6 +60,29 @@ PostgresDialect::drop_sequence(const String &seq_name) {
     return _T("DROP SEQUENCE ") + seq_name;
 }
 
+const String
+PostgresDialect::autoinc_flag()
+{
+    return _T("GENERATED BY DEFAULT AS IDENTITY");
+}
+
+int
+PostgresDialect::max_params() {
+    return 32767;
+}
+
+int
+PostgresDialect::insert_model()
+{
+    return (int)INSERT_VALUES_LIST;
+}
+
+int
+PostgresDialect::returning_model()
+{
+    return (int)RETURNING_CLAUSE;
+}
+
 // schema introspection
 bool
 PostgresDialect::table_exists(SqlConnection &conn, const String &table)
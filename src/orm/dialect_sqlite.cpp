@@ -55,6 +55,7 @@ SQLite3Dialect::type2sql(int t)
         case Value::DECIMAL:    return _T("NUMERIC");       break;
         case Value::DATETIME:   return _T("TIMESTAMP");     break;
         case Value::FLOAT:      return _T("DOUBLE PRECISION"); break;
+        case Value::BLOB:       return _T("BLOB");          break;
     }
     throw SqlDialectError(_T("Bad type"));
 }
@@ -95,6 +96,30 @@ SQLite3Dialect::autoinc_flag()
     return _T("AUTOINCREMENT");
 }
 
+int
+SQLite3Dialect::max_params()
+{
+    return 999;
+}
+
+int
+SQLite3Dialect::insert_model()
+{
+    return (int)INSERT_VALUES_LIST;
+}
+
+bool
+SQLite3Dialect::consecutive_insert_ids()
+{
+    return true;
+}
+
+int
+SQLite3Dialect::max_insert_rows()
+{
+    return 500;
+}
+
 // schema introspection
 
 static Strings
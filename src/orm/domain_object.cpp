@@ -35,6 +35,22 @@ InvalidIterator::InvalidIterator()
     : ORMError(_T("Trying to use an invalid iterator"))
 {}
 
+NoRelationFound::NoRelationFound(const String &class1,
+        const String &relation_name, const String &class2)
+    : ORMError(_T("No relation ")
+            + (str_empty(relation_name)? String(_T("")):
+                _T("'") + relation_name + _T("' "))
+            + _T("found between ") + class1 + _T(" and ") + class2)
+{}
+
+EagerSelfRelation::EagerSelfRelation(const String &class_name,
+        const String &relation_name)
+    : ORMError(_T("Can't load the relation ")
+            + (str_empty(relation_name)? String(_T("")):
+                _T("'") + relation_name + _T("' "))
+            + _T("of ") + class_name + _T(" to itself eagerly"))
+{}
+
 namespace {
 typedef std::pair<Tables, Relations> SchemaInfo;
 }
@@ -1,6 +1,7 @@
 // -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
 #define YBORM_SOURCE
 
+#include <climits>
 #include "driver_odbc.h"
 #include "util/string_utils.h"
 
@@ -13,15 +14,37 @@ using Yb::StrUtils::str_to_upper;
 
 namespace Yb {
 
-OdbcCursorBackend::OdbcCursorBackend(tiodbc::connection *conn)
+static TIMESTAMP_STRUCT to_timestamp(const DateTime &t)
+{
+    TIMESTAMP_STRUCT ts;
+    ts.year = dt_year(t);
+    ts.month = dt_month(t);
+    ts.day = dt_day(t);
+    ts.hour = (SQLUSMALLINT)dt_hour(t);
+    ts.minute = (SQLUSMALLINT)dt_minute(t);
+    ts.second = (SQLUSMALLINT)dt_second(t);
+    ts.fraction = dt_millisec(t) * 1000000;
+    return ts;
+}
+
+OdbcCursorBackend::OdbcCursorBackend(tiodbc::connection *conn,
+                                     int fetch_rows)
     : conn_(conn)
+    , fetch_rows_(fetch_rows)
 {}
 
 void
-OdbcCursorBackend::exec_direct(const String &sql)
+OdbcCursorBackend::new_stmt()
 {
     stmt_.reset(NULL);
     stmt_.reset(new tiodbc::statement());
+    stmt_->set_block_size(fetch_rows_);
+}
+
+void
+OdbcCursorBackend::exec_direct(const String &sql)
+{
+    new_stmt();
     if (!stmt_->execute_direct(*conn_, sql))
         throw DBError(stmt_->last_error_ex());
 }
@@ -29,8 +52,7 @@ OdbcCursorBackend::exec_direct(const String &sql)
 void
 OdbcCursorBackend::prepare(const String &sql)
 {
-    stmt_.reset(NULL);
-    stmt_.reset(new tiodbc::statement());
+    new_stmt();
     if (!stmt_->prepare(*conn_, sql))
         throw DBError(stmt_->last_error_ex());
 }
@@ -46,130 +68,319 @@ OdbcCursorBackend::exec(const Values &params)
     }
 }
 
+void
+OdbcCursorBackend::set_param(int num, const Value &x)
+{
+    switch (x.get_type()) {
+        case Value::INVALID: {
+            stmt_->param(num).set_as_null();
+            break;
+        }
+        case Value::DATETIME: {
+            stmt_->param(num).set_as_date_time(
+                    to_timestamp(x.read_as<DateTime>()), false);
+            break;
+        }
+        case Value::INTEGER: {
+            const int &v = x.read_as<int>();
+            stmt_->param(num).set_as_long(v, false);
+            break;
+        }
+        case Value::LONGINT: {
+            const LongInt &v = x.read_as<LongInt>();
+            stmt_->param(num).set_as_long_long(v, false);
+            break;
+        }
+        case Value::FLOAT: {
+            const double &v = x.read_as<double>();
+            stmt_->param(num).set_as_double(v, false);
+            break;
+        }
+        case Value::STRING: {
+            const String &s = x.read_as<String>();
+            stmt_->param(num).set_as_string(s, false);
+            break;
+        }
+        default: {
+            String s = x.as_string();
+            stmt_->param(num).set_as_string(s, false);
+        }
+    }
+}
+
 void
 OdbcCursorBackend::really_exec(const Values &params)
 {
-    for (size_t i = 0; i < params.size(); ++i) {
-        switch (params[i].get_type()) {
-            case Value::INVALID: {
-                stmt_->param(i + 1).set_as_null();
-                break;
-            }
-            case Value::DATETIME: {
-                const DateTime &t = params[i].read_as<DateTime>();
-                TIMESTAMP_STRUCT ts;
-                ts.year = dt_year(t);
-                ts.month = dt_month(t);
-                ts.day = dt_day(t);
-                ts.hour = (SQLUSMALLINT)dt_hour(t);
-                ts.minute = (SQLUSMALLINT)dt_minute(t);
-                ts.second = (SQLUSMALLINT)dt_second(t);
-                ts.fraction = dt_millisec(t) * 1000000;
-                stmt_->param(i + 1).set_as_date_time(ts, false);
-                break;
-            }
-            case Value::INTEGER: {
-                const int &x = params[i].read_as<int>();
-                stmt_->param(i + 1).set_as_long(x, false);
-                break;
-            }
-            case Value::LONGINT: {
-                const LongInt &x = params[i].read_as<LongInt>();
-                stmt_->param(i + 1).set_as_long_long(x, false);
-                break;
-            }
-            case Value::FLOAT: {
-                const double &x = params[i].read_as<double>();
-                stmt_->param(i + 1).set_as_double(x, false);
-                break;
-            }
-            case Value::STRING: {
-                const String &s = params[i].read_as<String>();
-                stmt_->param(i + 1).set_as_string(s, false);
+    for (size_t i = 0; i < params.size(); ++i)
+        set_param((int)i + 1, params[i]);
+    if (!stmt_->execute())
+        throw DBError(stmt_->last_error_ex());
+}
+
+static SQLSMALLINT batch_ctype(int type)
+{
+    switch (type) {
+        case Value::INTEGER:
+        case Value::LONGINT:
+            return SQL_C_SBIGINT;
+        case Value::FLOAT:
+            return SQL_C_DOUBLE;
+        case Value::DATETIME:
+            return SQL_C_TYPE_TIMESTAMP;
+        default:
+            return SQL_C_TCHAR;
+    }
+}
+
+void
+OdbcCursorBackend::exec_batch(const std::vector<Values> &params_rows)
+{
+    if (params_rows.empty())
+        return;
+    size_t n_params = params_rows[0].size(), n_rows = params_rows.size();
+    if (!n_params) {
+        SqlCursorBackend::exec_batch(params_rows);
+        return;
+    }
+    // Each column gets the C type of its values, strings if they differ
+    std::vector<tiodbc::param_array> arrays;
+    arrays.reserve(n_params);
+    for (size_t j = 0; j < n_params; ++j) {
+        SQLSMALLINT ctype = 0;
+        for (size_t i = 0; i < n_rows; ++i) {
+            int type = params_rows[i][j].get_type();
+            if (type == Value::INVALID)
+                continue;
+            SQLSMALLINT t = batch_ctype(type);
+            if (!ctype)
+                ctype = t;
+            else if (ctype != t) {
+                ctype = SQL_C_TCHAR;
                 break;
             }
-            default: {
-                String s = params[i].as_string();
-                stmt_->param(i + 1).set_as_string(s, false);
+        }
+        arrays.push_back(tiodbc::param_array(n_rows,
+                    ctype? ctype: (SQLSMALLINT)SQL_C_TCHAR));
+    }
+    for (size_t i = 0; i < n_rows; ++i) {
+        YB_ASSERT(params_rows[i].size() == n_params);
+        for (size_t j = 0; j < n_params; ++j) {
+            const Value &v = params_rows[i][j];
+            tiodbc::param_array &a = arrays[j];
+            if (v.is_null())
+                a.set_as_null(i);
+            else if (batch_ctype(v.get_type()) != a.get_ctype())
+                a.set_as_string(i, v.as_string());
+            else switch (v.get_type()) {
+                case Value::INTEGER:
+                    a.set_as_long_long(i, v.read_as<int>());
+                    break;
+                case Value::LONGINT:
+                    a.set_as_long_long(i, v.read_as<LongInt>());
+                    break;
+                case Value::FLOAT:
+                    a.set_as_double(i, v.read_as<double>());
+                    break;
+                case Value::DATETIME:
+                    a.set_as_date_time(i,
+                            to_timestamp(v.read_as<DateTime>()));
+                    break;
+                default:
+                    a.set_as_string(i, v.as_string());
             }
         }
     }
-    if (!stmt_->execute())
-        throw DBError(stmt_->last_error_ex());
+    std::vector<SQLUSMALLINT> status;
+    String error;
+    switch (stmt_->execute_batch(arrays, status, error)) {
+        case tiodbc::statement::batch_unsupported:
+            SqlCursorBackend::exec_batch(params_rows);
+            break;
+        case tiodbc::statement::batch_failed: {
+            std::vector<size_t> failed_rows;
+            for (size_t i = 0; i < status.size(); ++i)
+                if (status[i] == SQL_PARAM_ERROR ||
+                        status[i] == SQL_PARAM_DIAG_UNAVAILABLE)
+                    failed_rows.push_back(i);
+            // No per-row diagnostics: none of the rows is known to be done
+            if (failed_rows.empty())
+                for (size_t i = 0; i < status.size(); ++i)
+                    if (status[i] != SQL_PARAM_SUCCESS &&
+                            status[i] != SQL_PARAM_SUCCESS_WITH_INFO)
+                        failed_rows.push_back(i);
+            throw BatchExecError(error, failed_rows);
+        }
+        default:
+            break;
+    }
 }
 
 RowPtr
 OdbcCursorBackend::fetch_row()
 {
-    if (!stmt_->fetch_next())
+    Values values;
+    Strings names;
+    if (!fetch_values(values, &names))
         return RowPtr();
-    int col_count = stmt_->count_columns();
-    RowPtr row(new Row);
-    row->reserve(col_count);
-    for (int i = 0; i < col_count; ++i) {
-        tiodbc::field_impl f = stmt_->field(i + 1);
-        row->push_back(make_pair(str_to_upper(f.get_name()), Value()));
-        Value &v = (*row)[row->size() - 1].second;
-        switch (f.get_type()) {
-            case SQL_DATE:
-            case SQL_TIMESTAMP:
-            case SQL_TYPE_DATE:
-            case SQL_TYPE_TIME:
-            case SQL_TYPE_TIMESTAMP: {
-                TIMESTAMP_STRUCT ts = f.as_date_time();
-                if (!f.is_null())
-                    v = Value(dt_make(ts.year, ts.month, ts.day,
-                                       ts.hour, ts.minute, ts.second,
-                                       ts.fraction/1000000));
-                break;
-            }
-            case SQL_INTEGER:
-            case SQL_SMALLINT:
-            case SQL_TINYINT: {
-                int x = f.as_long();
-                if (!f.is_null())
-                    v = Value(x);
-                break;
-            }
-            case SQL_BIGINT: {
-                LongInt x = f.as_long_long();
-                if (!f.is_null())
-                    v = Value(x);
-                break;
-            }
-            case SQL_REAL:
-            case SQL_FLOAT:
-            case SQL_DOUBLE: {
-                double x = f.as_double();
-                if (!f.is_null())
-                    v = Value(x);
-                break;
-            }
-            case SQL_DECIMAL:
-            case SQL_NUMERIC: {
-                String x = f.as_string();
-                if (!f.is_null())
-                    v = Value(Decimal(x));
-                break;
-            }
-            default: {
-                String x = f.as_string();
-                if (!f.is_null())
-                    v = Value(x);
+    RowPtr row(new Row(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*row)[i].first = str_to_upper(names[i]);
+        (*row)[i].second.swap(values[i]);
+    }
+    return row;
+}
+
+bool
+OdbcCursorBackend::fetch_values(Values &values, Strings *names)
+{
+    try {
+        if (!stmt_->fetch_next())
+            return false;
+        int col_count = stmt_->count_columns();
+        values.resize(col_count);
+        if (names)
+            names->resize(col_count);
+        for (int i = 0; i < col_count; ++i) {
+            tiodbc::field_impl f = stmt_->field(i + 1, names != NULL);
+            if (names)
+                (*names)[i] = f.get_name();
+            Value &v = values[i];
+            v = Value();
+            switch (f.get_type()) {
+                case SQL_DATE:
+                case SQL_TIMESTAMP:
+                case SQL_TYPE_DATE:
+                case SQL_TYPE_TIME:
+                case SQL_TYPE_TIMESTAMP: {
+                    TIMESTAMP_STRUCT ts = f.as_date_time();
+                    if (!f.is_null())
+                        v = Value(dt_make(ts.year, ts.month, ts.day,
+                                           ts.hour, ts.minute, ts.second,
+                                           ts.fraction/1000000));
+                    break;
+                }
+                case SQL_INTEGER:
+                case SQL_SMALLINT:
+                case SQL_TINYINT: {
+                    // Read by 64 bits, as SQLite keeps them in an INTEGER
+                    // column, but give an int where it fits
+                    LongInt x = f.as_long_long();
+                    if (!f.is_null()) {
+                        if (x >= INT_MIN && x <= INT_MAX)
+                            v = Value((int)x);
+                        else
+                            v = Value(x);
+                    }
+                    break;
+                }
+                case SQL_BIGINT: {
+                    LongInt x = f.as_long_long();
+                    if (!f.is_null())
+                        v = Value(x);
+                    break;
+                }
+                case SQL_REAL:
+                case SQL_FLOAT:
+                case SQL_DOUBLE: {
+                    double x = f.as_double();
+                    if (!f.is_null())
+                        v = Value(x);
+                    break;
+                }
+                case SQL_DECIMAL:
+                case SQL_NUMERIC: {
+                    String x = f.as_string();
+                    if (!f.is_null())
+                        v = Value(Decimal(x));
+                    break;
+                }
+                default: {
+                    String x = f.as_string();
+                    if (!f.is_null())
+                        v = Value(x);
+                }
             }
         }
+        return true;
+    }
+    catch (const tiodbc::fetch_error &e) {
+        throw DBError(WIDEN(e.what()));
+    }
+}
+
+void
+OdbcCursorBackend::reset()
+{
+    if (stmt_.get())
+        stmt_->free_results();
+}
+
+bool
+OdbcCursorBackend::blob_streams()
+{
+    return true;
+}
+
+bool
+OdbcCursorBackend::read_blob(const String &table, const String &column,
+        const String &where, const Values &params, std::ostream &out)
+{
+    prepare(_T("SELECT ") + column + _T(" FROM ") + table
+            + _T(" WHERE ") + where);
+    // SQLGetData can't follow the block cursor
+    stmt_->set_block_size(1);
+    exec(params);
+    if (!stmt_->fetch_next())
+        throw NoDataFound(_T("No row to read the BLOB from"));
+    bool is_null = false;
+    if (!stmt_->get_binary(1, out, YB_BLOB_CHUNK_SIZE, is_null))
+        throw DBError(stmt_->last_error_ex());
+    stmt_->free_results();
+    return !is_null;
+}
+
+void
+OdbcCursorBackend::write_blob(const String &table, const String &column,
+        const String &where, const Values &params,
+        std::istream &in, LongInt size)
+{
+    // An UPDATE of no rows may still ask for the data, check first
+    prepare(_T("SELECT 1 FROM ") + table + _T(" WHERE ") + where);
+    exec(params);
+    if (!stmt_->fetch_next())
+        throw NoDataFound(_T("No row to write the BLOB to"));
+    prepare(_T("UPDATE ") + table + _T(" SET ") + column
+            + _T(" = ? WHERE ") + where);
+    try {
+        stmt_->param(1).set_as_binary_at_exec((SQLLEN)size);
+        for (size_t i = 0; i < params.size(); ++i)
+            set_param((int)i + 2, params[i]);
+    }
+    catch (const tiodbc::bind_error &) {
+        throw DBError(stmt_->last_error_ex());
+    }
+    String error;
+    if (!stmt_->execute_put_binary(in, (SQLLEN)size, YB_BLOB_CHUNK_SIZE,
+                error))
+    {
+        // The statement is cancelled, nothing is written then
+        if (!in)
+            throw ShortBlobStream();
+        throw DBError(error);
     }
-    return row;
 }
 
 OdbcConnectionBackend::OdbcConnectionBackend(OdbcDriver *drv)
     : drv_(drv)
+    , fetch_rows_(YB_ODBC_FETCH_ROWS)
 {}
 
 void
 OdbcConnectionBackend::open(SqlDialect *dialect, const SqlSource &source)
 {
     close();
+    fetch_rows_ = source.get_as<int>(String(_T("fetch_rows")),
+                                     YB_ODBC_FETCH_ROWS);
     conn_.reset(new tiodbc::connection());
     if (!conn_->connect(source.db(), source.user(), source.passwd(),
                 source.get_as<int>(String(_T("timeout")), 10),
@@ -195,7 +406,8 @@ auto_ptr<SqlCursorBackend>
 OdbcConnectionBackend::new_cursor()
 {
     auto_ptr<SqlCursorBackend> p(
-            (SqlCursorBackend *)new OdbcCursorBackend(conn_.get()));
+            (SqlCursorBackend *)new OdbcCursorBackend(conn_.get(),
+                                                      fetch_rows_));
     return p;
 }
 
@@ -43,6 +43,21 @@ QtSqlCursorBackend::prepare(const String &sql)
         throw DBError(stmt_->lastError().text());
 }
 
+static QVariant to_variant(const Value &x)
+{
+    if (x.is_null())
+        return QVariant();
+    if (x.get_type() == Value::DATETIME)
+        return QVariant(x.as_date_time());
+    if (x.get_type() == Value::INTEGER)
+        return QVariant(x.as_integer());
+    if (x.get_type() == Value::LONGINT)
+        return QVariant(x.as_longint());
+    if (x.get_type() == Value::FLOAT)
+        return QVariant(x.as_float());
+    return QVariant(x.as_string());
+}
+
 void
 QtSqlCursorBackend::exec(const Values &params)
 {
@@ -50,36 +65,89 @@ QtSqlCursorBackend::exec(const Values &params)
         for (unsigned i = 0; i < params.size(); ++i)
             bound_.push_back(QVariant());
     for (unsigned i = 0; i < params.size(); ++i) {
-        if (params[i].is_null())
-            bound_[i] = QVariant();
-        else if (params[i].get_type() == Value::DATETIME)
-            bound_[i] = QVariant(params[i].as_date_time());
-        else if (params[i].get_type() == Value::INTEGER)
-            bound_[i] = QVariant(params[i].as_integer());
-        else if (params[i].get_type() == Value::LONGINT)
-            bound_[i] = QVariant(params[i].as_longint());
-        else if (params[i].get_type() == Value::FLOAT)
-            bound_[i] = QVariant(params[i].as_float());
-        else
-            bound_[i] = QVariant(params[i].as_string());
+        bound_[i] = to_variant(params[i]);
         stmt_->bindValue(i, bound_[i]);
     }
     if (!stmt_->exec())
         throw DBError(stmt_->lastError().text());
 }
 
+void
+QtSqlCursorBackend::exec_batch(const std::vector<Values> &params_rows)
+{
+    if (params_rows.empty())
+        return;
+    size_t n_params = params_rows[0].size(), n_rows = params_rows.size();
+    if (!n_params) {
+        SqlCursorBackend::exec_batch(params_rows);
+        return;
+    }
+    for (size_t j = 0; j < n_params; ++j) {
+        // A NULL in the list must have the type of the column
+        QVariant::Type null_type = QVariant::String;
+        for (size_t i = 0; i < n_rows; ++i)
+            if (!params_rows[i][j].is_null()) {
+                null_type = to_variant(params_rows[i][j]).type();
+                break;
+            }
+        QVariantList values;
+        for (size_t i = 0; i < n_rows; ++i) {
+            YB_ASSERT(params_rows[i].size() == n_params);
+            const Value &x = params_rows[i][j];
+            values << (x.is_null()? QVariant(null_type): to_variant(x));
+        }
+        stmt_->bindValue((int)j, values);
+    }
+    bound_.clear();
+    if (!stmt_->execBatch())
+        // QSqlQuery doesn't tell the failed rows
+        throw BatchExecError(stmt_->lastError().text(), vector<size_t>());
+}
+
+bool
+QtSqlCursorBackend::last_insert_id(LongInt &id)
+{
+    // Told by the MySQL and SQLite drivers of Qt, with no extra query
+    if (!stmt_.get() || !conn_->driver()->hasFeature(QSqlDriver::LastInsertId))
+        return false;
+    QVariant x = stmt_->lastInsertId();
+    if (!x.isValid())
+        return false;
+    id = x.toLongLong();
+    return true;
+}
+
 RowPtr
 QtSqlCursorBackend::fetch_row()
 {
-    if (!stmt_->next())
+    Values values;
+    Strings names;
+    if (!fetch_values(values, &names))
         return RowPtr();
+    RowPtr row(new Row(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*row)[i].first = str_to_upper(names[i]);
+        (*row)[i].second.swap(values[i]);
+    }
+    return row;
+}
+
+bool
+QtSqlCursorBackend::fetch_values(Values &values, Strings *names)
+{
+    if (!stmt_->next())
+        return false;
     if (!rec_.get())
         rec_.reset(new QSqlRecord(stmt_->record()));
     int col_count = rec_->count();
-    RowPtr row(new Row);
+    values.resize(col_count);
+    if (names)
+        names->resize(col_count);
     for (int i = 0; i < col_count; ++i) {
-        String name = str_to_upper(rec_->fieldName(i));
-        Value v;
+        if (names)
+            (*names)[i] = rec_->fieldName(i);
+        Value &v = values[i];
+        v = Value();
         if (!stmt_->value(i).isNull()) {
             QVariant::Type t = rec_->field(i).type();
             if (t == QVariant::Bool || t == QVariant::Int ||
@@ -94,9 +162,15 @@ QtSqlCursorBackend::fetch_row()
             else
                 v = Value(stmt_->value(i).toString());
         }
-        row->push_back(RowItem(name, v));
     }
-    return row;
+    return true;
+}
+
+void
+QtSqlCursorBackend::reset()
+{
+    if (stmt_.get())
+        stmt_->finish();
 }
 
 QtSqlConnectionBackend::QtSqlConnectionBackend(QtSqlDriver *drv)
@@ -13,6 +13,17 @@ using namespace Yb::StrUtils;
 
 namespace Yb {
 
+static void to_tm(const DateTime &d, std::tm &x)
+{
+    memset(&x, 0, sizeof(x));
+    x.tm_year = dt_year(d) - 1900;
+    x.tm_mon = dt_month(d) - 1;
+    x.tm_mday = dt_day(d);
+    x.tm_hour = dt_hour(d);
+    x.tm_min = dt_minute(d);
+    x.tm_sec = dt_second(d);
+}
+
 SOCICursorBackend::SOCICursorBackend(soci::session *conn)
     : conn_(conn), stmt_(NULL), is_select_(false)
     , bound_first_(false), executed_(false)
@@ -168,14 +179,7 @@ SOCICursorBackend::exec(const Values &params)
                 }
                 case Value::DATETIME: {
                     std::tm &x = *(std::tm *)&(in_params_[i][0]);
-                    memset(&x, 0, sizeof(x));
-                    const DateTime &d = param.as_date_time();
-                    x.tm_year = dt_year(d) - 1900;
-                    x.tm_mon = dt_month(d) - 1;
-                    x.tm_mday = dt_day(d);
-                    x.tm_hour = dt_hour(d);
-                    x.tm_min = dt_minute(d);
-                    x.tm_sec = dt_second(d);
+                    to_tm(param.as_date_time(), x);
                     break;
                 }
                 default: {
@@ -190,24 +194,156 @@ SOCICursorBackend::exec(const Values &params)
     }
 }
 
+void
+SOCICursorBackend::exec_batch(const std::vector<Values> &params_rows)
+{
+    if (params_rows.empty())
+        return;
+    size_t n_params = params_rows[0].size(), n_rows = params_rows.size();
+    if (is_select_ || !n_params) {
+        SqlCursorBackend::exec_batch(params_rows);
+        return;
+    }
+    // The types are the bound ones, or those of the first values
+    TypeCodes types(param_types_);
+    if (types.size() != n_params) {
+        types.assign(n_params, (int)Value::STRING);
+        for (size_t j = 0; j < n_params; ++j)
+            for (size_t i = 0; i < n_rows; ++i)
+                if (!params_rows[i][j].is_null()) {
+                    types[j] = params_rows[i][j].get_type();
+                    break;
+                }
+    }
+    // One vector of values per parameter, soci sends them at once
+    vector<vector<int> > ints(n_params);
+    vector<vector<LongInt> > longs(n_params);
+    vector<vector<double> > doubles(n_params);
+    vector<vector<std::tm> > times(n_params);
+    vector<vector<string> > strs(n_params);
+    vector<vector<soci::indicator> > flags(n_params,
+            vector<soci::indicator>(n_rows, soci::i_ok));
+    try {
+        soci::statement stmt(*conn_);
+        stmt.alloc();
+        stmt.prepare(sql_);
+        for (size_t j = 0; j < n_params; ++j) {
+            for (size_t i = 0; i < n_rows; ++i) {
+                YB_ASSERT(params_rows[i].size() == n_params);
+                const Value &param = params_rows[i][j];
+                if (param.is_null())
+                    flags[j][i] = soci::i_null;
+                switch (types[j]) {
+                    case Value::INTEGER:
+                        ints[j].push_back(param.is_null()? 0:
+                                param.as_integer());
+                        break;
+                    case Value::LONGINT:
+                        longs[j].push_back(param.is_null()? 0:
+                                param.as_longint());
+                        break;
+                    case Value::FLOAT:
+                        doubles[j].push_back(param.is_null()? 0:
+                                param.as_float());
+                        break;
+                    case Value::DATETIME: {
+                        std::tm x;
+                        memset(&x, 0, sizeof(x));
+                        if (!param.is_null())
+                            to_tm(param.as_date_time(), x);
+                        times[j].push_back(x);
+                        break;
+                    }
+                    default:
+                        strs[j].push_back(param.is_null()? string():
+                                NARROW(param.as_string()));
+                }
+            }
+            switch (types[j]) {
+                case Value::INTEGER:
+                    stmt.exchange(soci::use(ints[j], flags[j]));
+                    break;
+                case Value::LONGINT:
+                    stmt.exchange(soci::use(longs[j], flags[j]));
+                    break;
+                case Value::FLOAT:
+                    stmt.exchange(soci::use(doubles[j], flags[j]));
+                    break;
+                case Value::DATETIME:
+                    stmt.exchange(soci::use(times[j], flags[j]));
+                    break;
+                default:
+                    stmt.exchange(soci::use(strs[j], flags[j]));
+            }
+        }
+        stmt.define_and_bind();
+        stmt.execute(true);
+    }
+    catch (const soci::soci_error &e) {
+        // soci doesn't tell the failed rows
+        throw BatchExecError(WIDEN(e.what()), vector<size_t>());
+    }
+}
+
+bool SOCICursorBackend::last_insert_id(LongInt &id)
+{
+#if defined(SOCI_VERSION) && SOCI_VERSION >= 300200
+    // Only these backends tell it with no extra query
+    // and without the name of a sequence
+    const std::string &backend = conn_->get_backend_name();
+    if (backend != "mysql" && backend != "sqlite3")
+        return false;
+    try {
+        long x = 0;
+        if (!conn_->get_last_insert_id(std::string(), x))
+            return false;
+        id = x;
+        return true;
+    }
+    catch (const soci::soci_error &e) {
+        throw DBError(WIDEN(e.what()));
+    }
+#else
+    return false;
+#endif
+}
+
 RowPtr SOCICursorBackend::fetch_row()
+{
+    Values values;
+    Strings names;
+    if (!fetch_values(values, &names))
+        return RowPtr();
+    RowPtr row(new Row(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*row)[i].first = str_to_upper(names[i]);
+        (*row)[i].second.swap(values[i]);
+    }
+    return row;
+}
+
+bool SOCICursorBackend::fetch_values(Values &values, Strings *names)
 {
     try {
         if (!stmt_->fetch()) {
 #ifdef YB_SOCI_DEBUG
             cerr << "fetch(): false" << endl;
 #endif
-            return RowPtr();
+            return false;
         }
-        RowPtr result(new Row);
         int col_count = row_.size();
 #ifdef YB_SOCI_DEBUG
         cerr << "fetch(): col_count=" << col_count << endl;
 #endif
+        values.resize(col_count);
+        if (names)
+            names->resize(col_count);
         for (int i = 0; i < col_count; ++i) {
             const soci::column_properties &props = row_.get_properties(i);
-            String name = str_to_upper(WIDEN(props.get_name()));
-            Value v;
+            if (names)
+                (*names)[i] = WIDEN(props.get_name());
+            Value &v = values[i];
+            v = Value();
             if (row_.get_indicator(i) != soci::i_null) {
                 std::tm when;
                 unsigned long long x;
@@ -248,9 +384,8 @@ RowPtr SOCICursorBackend::fetch_row()
                 << " type=" << props.get_data_type()
                 << " value=" << NARROW(v.sql_str()) << endl;
 #endif
-            result->push_back(make_pair(name, v));
         }
-        return result;
+        return true;
     }
     catch (const soci::soci_error &e) {
         throw DBError(WIDEN(e.what()));
@@ -1,6 +1,7 @@
 // -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
 #define YBORM_SOURCE
 
+#include <algorithm>
 #include "driver_sqlite.h"
 #include "util/string_utils.h"
 
@@ -27,6 +28,15 @@ SQLiteCursorBackend::close()
         last_code_ = 0;
         exec_count_ = 0;
     }
+    types_.clear();
+    real_cols_.clear();
+}
+
+void
+SQLiteCursorBackend::check_code(int code)
+{
+    if (SQLITE_OK != code)
+        throw DBError(WIDEN(sqlite3_errmsg(conn_)));
 }
 
 void
@@ -50,62 +60,256 @@ SQLiteCursorBackend::prepare(const String &sql)
     }
 }
 
+void
+SQLiteCursorBackend::bind_params(const TypeCodes &types)
+{
+    types_ = types;
+}
+
+void
+SQLiteCursorBackend::bind_value(int i, const Value &x)
+{
+    int type = x.get_type();
+    if (Value::INVALID == type) {
+        check_code(sqlite3_bind_null(stmt_, i + 1));
+        return;
+    }
+    // A number bound to a float column is passed as double, otherwise
+    // the storage class follows the type of the value
+    if ((size_t)i < types_.size() && Value::FLOAT == types_[i] &&
+            (Value::INTEGER == type || Value::LONGINT == type ||
+             Value::DECIMAL == type))
+        type = Value::FLOAT;
+    switch (type) {
+    case Value::INTEGER:
+    case Value::LONGINT:
+        check_code(sqlite3_bind_int64(stmt_, i + 1, x.as_longint()));
+        break;
+    case Value::FLOAT:
+        check_code(sqlite3_bind_double(stmt_, i + 1, x.as_float()));
+        break;
+    case Value::BLOB:
+        {
+            const Blob &b = x.read_as_blob();
+            check_code(sqlite3_bind_blob(stmt_, i + 1,
+                        b.empty()? "": &b[0], (int)b.size(),
+                        SQLITE_TRANSIENT));
+        }
+        break;
+    default:
+        {
+            // SQLite may read a parameter again on any later step,
+            // so it takes its own copy of the buffer
+            const string buf = NARROW(x.as_string());
+            check_code(sqlite3_bind_text(stmt_, i + 1,
+                        buf.c_str(), (int)buf.size(), SQLITE_TRANSIENT));
+        }
+    }
+}
+
 void
 SQLiteCursorBackend::exec(const Values &params)
 {
     if (exec_count_)
         sqlite3_reset(stmt_);
     ++exec_count_;
-    vector<string> str_params(params.size());
-    for (size_t i = 0; i < params.size(); ++i) {
-        if (params[i].get_type() == Value::INTEGER
-                || params[i].get_type() == Value::LONGINT)
-        {
-            sqlite3_bind_int(stmt_, i + 1, params[i].as_integer());
-            if (SQLITE_OK != sqlite3_errcode(conn_)) {
-                const char *err = sqlite3_errmsg(conn_);
-                throw DBError(WIDEN(err));
-            }
-        } else if (params[i].is_null()) {
-            sqlite3_bind_null(stmt_, i + 1);
-            if (SQLITE_OK != sqlite3_errcode(conn_)) {
-                const char *err = sqlite3_errmsg(conn_);
-                throw DBError(WIDEN(err));
-            }
-        } else {
-            str_params[i] = NARROW(params[i].as_string());
-            sqlite3_bind_text(stmt_, i + 1,
-                    str_params[i].c_str(), str_params[i].size(), SQLITE_STATIC);
-            if (SQLITE_OK != sqlite3_errcode(conn_)) {
-                const char *err = sqlite3_errmsg(conn_);
-                throw DBError(WIDEN(err));
-            }
-        }
-    }
+    for (size_t i = 0; i < params.size(); ++i)
+        bind_value((int)i, params[i]);
     last_code_ = sqlite3_step(stmt_);
     if (last_code_ != SQLITE_DONE && last_code_ != SQLITE_ROW
             && last_code_ != SQLITE_OK)
         throw DBError(WIDEN(sqlite3_errmsg(conn_)));
 }
 
+void
+SQLiteCursorBackend::fetch_value(int i, Value &x)
+{
+    switch (sqlite3_column_type(stmt_, i)) {
+    case SQLITE_NULL:
+        x = Value();
+        break;
+    case SQLITE_INTEGER:
+        x = Value((LongInt)sqlite3_column_int64(stmt_, i));
+        break;
+    case SQLITE_FLOAT:
+        // A NUMERIC column may keep a decimal as REAL, the text
+        // rendering of it is exact enough while a double isn't
+        if (real_cols_[i]) {
+            x = Value(sqlite3_column_double(stmt_, i));
+            break;
+        }
+        x = Value(WIDEN((const char *)sqlite3_column_text(stmt_, i)));
+        break;
+    case SQLITE_BLOB:
+        {
+            const char *p = (const char *)sqlite3_column_blob(stmt_, i);
+            x = Value(Blob(p, p + sqlite3_column_bytes(stmt_, i)));
+        }
+        break;
+    default:
+        x = Value(WIDEN((const char *)sqlite3_column_text(stmt_, i)));
+    }
+}
+
 RowPtr SQLiteCursorBackend::fetch_row()
 {
-    if (SQLITE_DONE == last_code_ || SQLITE_OK == last_code_)
+    Values values;
+    Strings names;
+    if (!fetch_values(values, &names))
         return RowPtr();
+    RowPtr row(new Row(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*row)[i].first = str_to_upper(names[i]);
+        (*row)[i].second.swap(values[i]);
+    }
+    return row;
+}
+
+bool SQLiteCursorBackend::fetch_values(Values &values, Strings *names)
+{
+    if (SQLITE_DONE == last_code_ || SQLITE_OK == last_code_)
+        return false;
     if (SQLITE_ROW != last_code_)
         throw DBError(WIDEN(sqlite3_errmsg(conn_)));
     int col_count = sqlite3_column_count(stmt_);
-    RowPtr row(new Row(col_count));
+    if (real_cols_.size() != (size_t)col_count) {
+        // Columns declared with REAL affinity, see the SQLite docs
+        real_cols_.resize(col_count);
+        for (int i = 0; i < col_count; ++i) {
+            const char *decl = sqlite3_column_decltype(stmt_, i);
+            string t = decl? NARROW(str_to_upper(WIDEN(decl))): string();
+            real_cols_[i] = t.find("INT") == string::npos &&
+                (t.find("REAL") != string::npos ||
+                 t.find("FLOA") != string::npos ||
+                 t.find("DOUB") != string::npos);
+        }
+    }
+    values.resize(col_count);
+    if (names)
+        names->resize(col_count);
     for (int i = 0; i < col_count; ++i) {
-        String name = str_to_upper(WIDEN(sqlite3_column_name(stmt_, i)));
-        int type = sqlite3_column_type(stmt_, i);
-        (*row)[i].first = name;
-        if (SQLITE_NULL != type)
-            (*row)[i].second = Value(
-                    WIDEN((const char *)sqlite3_column_text(stmt_, i)));
+        if (names)
+            (*names)[i] = WIDEN(sqlite3_column_name(stmt_, i));
+        fetch_value(i, values[i]);
     }
     last_code_ = sqlite3_step(stmt_);
-    return row;
+    return true;
+}
+
+bool SQLiteCursorBackend::last_insert_id(LongInt &id)
+{
+    id = sqlite3_last_insert_rowid(conn_);
+    return true;
+}
+
+void SQLiteCursorBackend::reset()
+{
+    if (stmt_) {
+        sqlite3_reset(stmt_);
+        last_code_ = 0;
+    }
+}
+
+bool SQLiteCursorBackend::blob_streams()
+{
+    return true;
+}
+
+// Closes the BLOB handle on the way out
+struct SQLiteBlobGuard
+{
+    sqlite3_blob *blob_;
+    SQLiteBlobGuard(): blob_(NULL) {}
+    ~SQLiteBlobGuard() { if (blob_) sqlite3_blob_close(blob_); }
+    int close() {
+        int code = sqlite3_blob_close(blob_);
+        blob_ = NULL;
+        return code;
+    }
+};
+
+// The incremental BLOB I/O works by ROWID, so look it up first,
+// the table must not be a WITHOUT ROWID one
+bool SQLiteCursorBackend::find_blob_row(const String &table,
+        const String &column, const String &where, const Values &params,
+        LongInt &rowid)
+{
+    prepare(_T("SELECT ROWID, ") + column + _T(" IS NULL FROM ")
+            + table + _T(" WHERE ") + where);
+    exec(params);
+    Values values;
+    bool found = fetch_values(values, NULL);
+    close();
+    if (!found)
+        throw NoDataFound(_T("No row to access the BLOB of"));
+    rowid = values[0].as_longint();
+    return !values[1].as_longint();
+}
+
+bool SQLiteCursorBackend::read_blob(const String &table,
+        const String &column, const String &where, const Values &params,
+        std::ostream &out)
+{
+    LongInt rowid = 0;
+    if (!find_blob_row(table, column, where, params, rowid))
+        return false;
+    SQLiteBlobGuard g;
+    check_code(sqlite3_blob_open(conn_, "main", NARROW(table).c_str(),
+                NARROW(column).c_str(), rowid, 0, &g.blob_));
+    int size = sqlite3_blob_bytes(g.blob_);
+    vector<char> buf(std::min(size, YB_BLOB_CHUNK_SIZE));
+    for (int pos = 0; pos < size; pos += (int)buf.size()) {
+        int n = std::min(size - pos, (int)buf.size());
+        check_code(sqlite3_blob_read(g.blob_, &buf[0], n, pos));
+        out.write(&buf[0], n);
+    }
+    check_code(g.close());
+    return true;
+}
+
+void SQLiteCursorBackend::write_blob(const String &table,
+        const String &column, const String &where, const Values &params,
+        std::istream &in, LongInt size)
+{
+    LongInt rowid = 0;
+    find_blob_row(table, column, where, params, rowid);
+    // The value is zeroed before the stream is read, so a savepoint
+    // brings the old one back if the stream ends early
+    exec_direct(_T("SAVEPOINT YB_WRITE_BLOB"));
+    try {
+        // Allocate the space, then fill it chunk by chunk
+        prepare(_T("UPDATE ") + table + _T(" SET ") + column
+                + _T(" = ZEROBLOB(?) WHERE ROWID = ?"));
+        Values zero_params(2);
+        zero_params[0] = Value(size);
+        zero_params[1] = Value(rowid);
+        exec(zero_params);
+        close();
+        if (size > 0) {
+            SQLiteBlobGuard g;
+            check_code(sqlite3_blob_open(conn_, "main",
+                        NARROW(table).c_str(), NARROW(column).c_str(),
+                        rowid, 1, &g.blob_));
+            vector<char> buf(
+                    (size_t)std::min(size, (LongInt)YB_BLOB_CHUNK_SIZE));
+            for (LongInt pos = 0; pos < size; pos += buf.size()) {
+                int n = (int)std::min(size - pos, (LongInt)buf.size());
+                in.read(&buf[0], n);
+                if (in.gcount() != n)
+                    throw ShortBlobStream();
+                check_code(sqlite3_blob_write(g.blob_, &buf[0], n,
+                            (int)pos));
+            }
+            check_code(g.close());
+        }
+    }
+    catch (...) {
+        close();
+        sqlite3_exec(conn_, "ROLLBACK TO YB_WRITE_BLOB", 0, 0, 0);
+        sqlite3_exec(conn_, "RELEASE YB_WRITE_BLOB", 0, 0, 0);
+        throw;
+    }
+    exec_direct(_T("RELEASE YB_WRITE_BLOB"));
 }
 
 SQLiteConnectionBackend::SQLiteConnectionBackend(SQLiteDriver *drv)
@@ -29,27 +29,73 @@ EngineBase::exec_select(const String &sql, const Values &params)
     return rs;
 }
 
-SqlResultSet
-EngineBase::select_iter(const Expression &select_expr)
+const SqlGeneratorOptions
+EngineBase::sql_options()
 {
-    SqlGeneratorOptions options(NO_QUOTES,
+    return SqlGeneratorOptions(NO_QUOTES,
             get_dialect()->has_for_update(),
             true,
             get_conn()->get_driver()->numbered_params(),
             (Yb::SqlPagerModel)get_dialect()->pager_model());
-    SqlGeneratorContext ctx;
-    String sql = select_expr.generate_sql(options, &ctx);
+}
+
+SqlResultSet
+EngineBase::exec_select_retry(const String &sql, const Values &params)
+{
     if (get_conn()->activity())
-        return exec_select(sql, ctx.params_);
+        return exec_select(sql, params);
     MilliSec t0 = get_cur_time_millisec();
     try {
-        return exec_select(sql, ctx.params_);
+        return exec_select(sql, params);
     }
     catch (const DBError &) {
         if (get_cur_time_millisec() - t0 > 500 || !reconnect())
             throw;
-        return exec_select(sql, ctx.params_);
+        return exec_select(sql, params);
+    }
+}
+
+SqlResultSet
+EngineBase::select_iter(const Expression &select_expr)
+{
+    SqlGeneratorContext ctx;
+    String sql = select_expr.generate_sql(sql_options(), &ctx);
+    return exec_select_retry(sql, ctx.params_);
+}
+
+SqlResultSet
+EngineBase::select_iter(const Schema &schema,
+        const Expression &from_where, const Expression &filter,
+        const Expression &order_by, bool for_update_flag,
+        int limit, int offset, Strings &tables)
+{
+    QueryCache &cache = schema.query_cache();
+    if (!cache.enabled()) {
+        SelectExpr select_expr = make_select(schema, from_where, filter,
+                order_by, for_update_flag, limit, offset, &tables);
+        return select_iter(select_expr);
+    }
+    SqlGeneratorOptions options = sql_options();
+    SelectExpr shape(Expression(_T("*")));
+    shape.from_(from_where).where_(filter).order_by_(order_by)
+        .for_update(for_update_flag);
+    if (limit)
+        shape.pager(limit, offset);
+    SqlGeneratorContext ctx;
+    String key = get_dialect()->get_name() + _T(":")
+        + to_string((int)options.numbered_params_) + _T(":")
+        + shape.generate_sql(options, &ctx);
+    CompiledQuery query;
+    if (!cache.get(key, query)) {
+        SelectExpr select_expr = make_select(schema, from_where, filter,
+                order_by, for_update_flag, limit, offset, &query.tables);
+        SqlGeneratorContext full_ctx;
+        query.sql = select_expr.generate_sql(options, &full_ctx);
+        YB_ASSERT(full_ctx.params_.size() == ctx.params_.size());
+        cache.put(key, query);
     }
+    tables.swap(query.tables);
+    return exec_select_retry(query.sql, ctx.params_);
 }
 
 RowsPtr
@@ -68,6 +114,39 @@ EngineBase::select(const Expression &what,
     return rows;
 }
 
+static void
+fill_insert_params(Values &params, const DmlPlan &plan,
+        const RowsData &rows, size_t pos, size_t n)
+{
+    const vector<int> &col_idx = plan.col_idx;
+    size_t n_cols = col_idx.size();
+    for (size_t k = 0; k < n; ++k) {
+        const Values &row = *rows[pos + k];
+        for (size_t j = 0; j < n_cols; ++j)
+            params[k * n_cols + j] = row[col_idx[j]];
+    }
+}
+
+// Run the batch of parameter sets, each one covers rows_per_set rows
+// starting from the row first_row, tell the failed rows by their positions
+static void
+exec_rows_batch(SqlCursor &cursor, vector<Values> &params_rows,
+        size_t first_row, size_t rows_per_set)
+{
+    try {
+        cursor.exec_batch(params_rows);
+    }
+    catch (const BatchExecError &e) {
+        vector<size_t> failed_rows;
+        for (size_t i = 0; i < e.failed_rows().size(); ++i)
+            for (size_t k = 0; k < rows_per_set; ++k)
+                failed_rows.push_back(first_row
+                        + e.failed_rows()[i] * rows_per_set + k);
+        throw BatchExecError(e.reason(), failed_rows);
+    }
+    params_rows.clear();
+}
+
 const vector<LongInt>
 EngineBase::insert(const Table &table, const RowsData &rows,
         bool collect_new_ids)
@@ -79,28 +158,89 @@ EngineBase::insert(const Table &table, const RowsData &rows,
     if (!rows.size())
         return ids;
     touch();
-    String sql;
-    TypeCodes type_codes;
-    ParamNums param_nums;
-    gen_sql_insert(sql, type_codes, param_nums, table,
-            !collect_new_ids, get_conn()->get_driver()->numbered_params());
-    Values params(type_codes.size());
+    SqlDialect *dialect = get_dialect();
+    int insert_model = dialect->insert_model();
+    int returning = collect_new_ids? dialect->returning_model():
+        (int)RETURNING_NONE;
+    DmlPlan tmp;
+    const DmlPlan *plan = &insert_plan(table, !collect_new_ids,
+            1, returning, tmp);
+    size_t n_cols = plan->col_idx.size();
+    // Put several rows into a single statement, where possible
+    size_t max_batch = 1;
+    if (insert_model != INSERT_ONE_ROW && n_cols) {
+        max_batch = std::min(rows.size(),
+                (size_t)dialect->max_params() / n_cols);
+        max_batch = std::min(max_batch, (size_t)dialect->max_insert_rows());
+        if (max_batch < 1)
+            max_batch = 1;
+    }
+    // The new ids are told for one row at a time, unless
+    // the driver tells the last one and they are consecutive
+    size_t batch = collect_new_ids? 1: max_batch;
     auto_ptr<SqlCursor> cursor = get_conn()->new_cursor();
-    cursor->prepare(sql);
-    cursor->bind_params(type_codes);
     auto_ptr<SqlCursor> cursor2;
-    if (collect_new_ids)
-        cursor2.reset(get_conn()->new_cursor().release());
-    RowsData::const_iterator r = rows.begin(), rend = rows.end();
-    for (; r != rend; ++r) {
-        ParamNums::const_iterator f = param_nums.begin(),
-            fend = param_nums.end();
-        for (; f != fend; ++f)
-            params[f->second] = (**r)[table.idx_by_name(f->first)];
+    Values params;
+    size_t prepared_rows = 0, pos = 0;
+    if (!collect_new_ids) {
+        // The statements for max_batch rows go by batches
+        // of parameter sets, the rest of rows goes after them
+        size_t n_sets = rows.size() / max_batch;
+        if (n_sets) {
+            if (max_batch > 1)
+                plan = &insert_plan(table, true, (int)max_batch,
+                        returning, tmp);
+            cursor->prepare(plan->sql);
+            cursor->bind_params(plan->type_codes);
+            prepared_rows = max_batch;
+        }
+        vector<Values> params_rows;
+        size_t first_row = 0;
+        for (size_t i = 0; i < n_sets; ++i, pos += max_batch) {
+            params_rows.push_back(Values(plan->type_codes.size()));
+            fill_insert_params(params_rows.back(), *plan,
+                    rows, pos, max_batch);
+            if (params_rows.size() == YB_EXEC_BATCH_SIZE
+                    || i + 1 == n_sets)
+            {
+                exec_rows_batch(*cursor, params_rows, first_row, max_batch);
+                first_row = pos + max_batch;
+            }
+        }
+    }
+    while (pos < rows.size()) {
+        size_t n = std::min(batch, rows.size() - pos);
+        if (n != prepared_rows) {
+            if (n > 1 || prepared_rows)
+                plan = &insert_plan(table, !collect_new_ids,
+                        (int)n, returning, tmp);
+            cursor->prepare(plan->sql);
+            cursor->bind_params(plan->type_codes);
+            params.resize(plan->type_codes.size());
+            prepared_rows = n;
+        }
+        fill_insert_params(params, *plan, rows, pos, n);
+        pos += n;
         cursor->exec(params);
-        if (collect_new_ids) {
-            cursor2->prepare(get_dialect()->
-                    select_last_inserted_id(table.name()));
+        if (!collect_new_ids)
+            continue;
+        LongInt last_id;
+        if (returning != RETURNING_NONE) {
+            RowsPtr id_rows = cursor->fetch_rows();
+            ids.push_back((*id_rows)[0][0].second.as_longint());
+        }
+        else if (cursor->last_insert_id(last_id)) {
+            for (LongInt k = (LongInt)n - 1; k >= 0; --k)
+                ids.push_back(last_id - k);
+            if (dialect->consecutive_insert_ids())
+                batch = max_batch;
+        }
+        else {
+            if (!cursor2.get()) {
+                cursor2.reset(get_conn()->new_cursor().release());
+                cursor2->prepare(dialect->
+                        select_last_inserted_id(table.name()));
+            }
             cursor2->exec(Values());
             RowsPtr id_rows = cursor2->fetch_rows();
             ids.push_back((*id_rows)[0][0].second.as_longint());
@@ -110,7 +250,8 @@ EngineBase::insert(const Table &table, const RowsData &rows,
 }
 
 void
-EngineBase::update(const Table &table, const RowsData &rows)
+EngineBase::update(const Table &table, const RowsData &rows,
+        const vector<bool> *columns)
 {
     if (get_mode() == READ_ONLY)
         throw BadOperationInMode(
@@ -118,26 +259,42 @@ EngineBase::update(const Table &table, const RowsData &rows)
     if (!rows.size())
         return;
     touch();
-    String sql;
-    TypeCodes type_codes;
-    ParamNums param_nums;
-    SqlGeneratorOptions options(NO_QUOTES,
-            get_dialect()->has_for_update(),
-            true,
-            get_conn()->get_driver()->numbered_params(),
-            (Yb::SqlPagerModel)get_dialect()->pager_model());
-    gen_sql_update(sql, type_codes, param_nums, table, options);
+    DmlPlan tmp;
+    const DmlPlan &plan = update_plan(table, columns, tmp);
+    if (plan.type_codes.size() == table.pk_fields().size())
+        return; // nothing to update
     auto_ptr<SqlCursor> cursor = get_conn()->new_cursor();
-    cursor->prepare(sql);
-    cursor->bind_params(type_codes);
-    Values params(type_codes.size());
-    RowsData::const_iterator r = rows.begin(), rend = rows.end();
-    for (; r != rend; ++r) {
-        ParamNums::const_iterator f = param_nums.begin(),
-            fend = param_nums.end();
-        for (; f != fend; ++f)
-            params[f->second] = (**r)[table.idx_by_name(f->first)];
-        cursor->exec(params);
+    cursor->prepare(plan.sql);
+    cursor->bind_params(plan.type_codes);
+    size_t n_params = plan.col_idx.size();
+    vector<Values> params_rows;
+    size_t first_row = 0;
+    for (size_t pos = 0; pos < rows.size(); ++pos) {
+        const Values &row = *rows[pos];
+        params_rows.push_back(Values(n_params));
+        Values &params = params_rows.back();
+        for (size_t j = 0; j < n_params; ++j)
+            params[j] = row[plan.col_idx[j]];
+        if (params_rows.size() == YB_EXEC_BATCH_SIZE
+                || pos + 1 == rows.size())
+        {
+            exec_rows_batch(*cursor, params_rows, first_row, 1);
+            first_row = pos + 1;
+        }
+    }
+}
+
+static void
+fill_delete_params(Values &params, const Keys &keys, size_t pos, size_t n)
+{
+    size_t j = 0;
+    for (size_t k = 0; k < n; ++k) {
+        const Key &key = keys[pos + k];
+        if (key.id_name)
+            params[j++] = key.id_value;
+        else
+            for (size_t i = 0; i < key.fields.size(); ++i)
+                params[j++] = key.fields[i].second;
     }
 }
 
@@ -150,29 +307,81 @@ EngineBase::delete_from(const Table &table, const Keys &keys)
     if (!keys.size())
         return;
     touch();
-    String sql;
-    TypeCodes type_codes;
-    SqlGeneratorOptions options(NO_QUOTES,
-            get_dialect()->has_for_update(),
-            true,
-            get_conn()->get_driver()->numbered_params(),
-            (Yb::SqlPagerModel)get_dialect()->pager_model());
-    gen_sql_delete(sql, type_codes, table, options);
+    // Delete several keys per statement, using an IN-list
+    // or OR-ed key predicates
+    size_t key_size = table.pk_fields().size();
+    size_t max_batch = 1;
+    if (key_size)
+        max_batch = std::min(keys.size(),
+                (size_t)get_dialect()->max_params() / key_size);
+    if (max_batch < 1)
+        max_batch = 1;
     auto_ptr<SqlCursor> cursor = get_conn()->new_cursor();
-    cursor->prepare(sql);
-    cursor->bind_params(type_codes);
-    Values params(type_codes.size());
-    Keys::const_iterator k = keys.begin(), kend = keys.end();
-    for (; k != kend; ++k) {
-        if (k->id_name)
-            params[0] = k->id_value;
-        else
-            for (size_t i = 0; i < k->fields.size(); ++i)
-                params[i] = k->fields[i].second;
+    // The statements for max_batch keys go by batches
+    // of parameter sets, the rest of keys goes after them
+    size_t n_sets = keys.size() / max_batch, pos = 0;
+    if (n_sets > 0) {
+        DmlPlan tmp;
+        const DmlPlan &plan = delete_plan(table, (int)max_batch, tmp);
+        cursor->prepare(plan.sql);
+        cursor->bind_params(plan.type_codes);
+        vector<Values> params_rows;
+        size_t first_key = 0;
+        for (size_t i = 0; i < n_sets; ++i, pos += max_batch) {
+            params_rows.push_back(Values(plan.type_codes.size()));
+            fill_delete_params(params_rows.back(), keys, pos, max_batch);
+            if (params_rows.size() == YB_EXEC_BATCH_SIZE || i + 1 == n_sets) {
+                exec_rows_batch(*cursor, params_rows, first_key, max_batch);
+                first_key = pos + max_batch;
+            }
+        }
+    }
+    if (pos < keys.size()) {
+        size_t n = keys.size() - pos;
+        DmlPlan tmp2;
+        const DmlPlan &plan2 = delete_plan(table, (int)n, tmp2);
+        cursor->prepare(plan2.sql);
+        cursor->bind_params(plan2.type_codes);
+        Values params(plan2.type_codes.size());
+        fill_delete_params(params, keys, pos, n);
         cursor->exec(params);
     }
 }
 
+// The filter by key with '?' markers, SqlCursor numbers them if needed
+static const String blob_key_filter(const Key &key, Values &params)
+{
+    SqlGeneratorContext ctx;
+    String where = KeyFilter(key).generate_sql(
+            SqlGeneratorOptions(NO_QUOTES, true, true, false), &ctx);
+    params.swap(ctx.params_);
+    return where;
+}
+
+bool
+EngineBase::read_blob(const Table &table, const String &column,
+        const Key &key, std::ostream &out)
+{
+    Values params;
+    String where = blob_key_filter(key, params);
+    auto_ptr<SqlCursor> cursor = get_conn()->new_cursor();
+    return cursor->read_blob(table.name(), column, where, params, out);
+}
+
+void
+EngineBase::write_blob(const Table &table, const String &column,
+        const Key &key, std::istream &in, LongInt size)
+{
+    if (get_mode() == READ_ONLY)
+        throw BadOperationInMode(
+                _T("Using UPDATE operation in read-only mode"));
+    touch();
+    Values params;
+    String where = blob_key_filter(key, params);
+    auto_ptr<SqlCursor> cursor = get_conn()->new_cursor();
+    cursor->write_blob(table.name(), column, where, params, in, size);
+}
+
 void
 EngineBase::exec_proc(const String &proc_code)
 {
@@ -313,38 +522,140 @@ EngineBase::drop_schema(const Schema &schema, bool ignore_errors)
     }
 }
 
+const String
+EngineBase::dml_plan_key(const String &op, const String &args)
+{
+    return op + _T(":") + get_dialect()->get_name() + _T(":")
+        + get_conn()->get_driver()->get_name() + _T(":") + args;
+}
+
+static void
+set_plan_columns(DmlPlan &plan, const Table &table,
+        const ParamNums &param_nums)
+{
+    plan.col_idx.resize(param_nums.size());
+    ParamNums::const_iterator f = param_nums.begin(),
+        fend = param_nums.end();
+    for (; f != fend; ++f)
+        plan.col_idx[f->second] = table.idx_by_name(f->first);
+}
+
+static const DmlPlan &
+store_plan(const Table &table, const String &key, DmlPlan &tmp)
+{
+    const DmlPlan *plan = table.add_dml_plan(key, tmp);
+    return plan? *plan: tmp;
+}
+
+const DmlPlan &
+EngineBase::insert_plan(const Table &table, bool include_pk,
+        int n_rows, int returning_model, DmlPlan &tmp)
+{
+    String key = dml_plan_key(_T("INSERT"), to_string((int)include_pk)
+            + _T(",") + to_string(n_rows)
+            + _T(",") + to_string(returning_model));
+    const DmlPlan *plan = table.find_dml_plan(key);
+    if (plan)
+        return *plan;
+    ParamNums param_nums;
+    gen_sql_insert(tmp.sql, tmp.type_codes, param_nums, table, include_pk,
+            get_conn()->get_driver()->numbered_params(), n_rows,
+            get_dialect()->insert_model(), returning_model);
+    set_plan_columns(tmp, table, param_nums);
+    return store_plan(table, key, tmp);
+}
+
+const DmlPlan &
+EngineBase::update_plan(const Table &table,
+        const vector<bool> *columns, DmlPlan &tmp)
+{
+    String mask = _T("*");
+    if (columns) {
+        mask = String();
+        for (size_t i = 0; i < columns->size(); ++i)
+            mask += (*columns)[i]? _T("1"): _T("0");
+    }
+    String key = dml_plan_key(_T("UPDATE"), mask);
+    const DmlPlan *plan = table.find_dml_plan(key);
+    if (plan)
+        return *plan;
+    ParamNums param_nums;
+    gen_sql_update(tmp.sql, tmp.type_codes, param_nums, table,
+            sql_options(), columns);
+    set_plan_columns(tmp, table, param_nums);
+    return store_plan(table, key, tmp);
+}
+
+const DmlPlan &
+EngineBase::delete_plan(const Table &table, int n_keys, DmlPlan &tmp)
+{
+    String key = dml_plan_key(_T("DELETE"), to_string(n_keys));
+    const DmlPlan *plan = table.find_dml_plan(key);
+    if (plan)
+        return *plan;
+    gen_sql_delete(tmp.sql, tmp.type_codes, table, sql_options(), n_keys);
+    tmp.col_idx.clear();
+    return store_plan(table, key, tmp);
+}
+
 void
 EngineBase::gen_sql_insert(String &sql, TypeCodes &type_codes_out,
         ParamNums &param_nums_out, const Table &table,
-        bool include_pk, bool numbered_params)
+        bool include_pk, bool numbered_params,
+        int n_rows, int insert_model, int returning_model)
 {
-    int count = 1, *pcount = NULL;
-    if (numbered_params)
-        pcount = &count;
-    String sql_query;
-    sql_query = _T("INSERT INTO ") + table.name() + _T(" (");
+    int count = 1;
     TypeCodes type_codes;
-    type_codes.reserve(table.size());
+    type_codes.reserve(table.size() * n_rows);
     ParamNums param_nums;
-    Strings names, pholders;
+    Strings names;
     size_t i;
     for (i = 0; i < table.size(); ++i) {
         const Column &col = table[i];
         if ((!col.is_ro() || col.is_pk()) &&
                 (!col.is_pk() || include_pk))
         {
-            if (pcount)
-                pholders.push_back(_T(":") + to_string(count));
-            else
-                pholders.push_back(_T("?"));
-            ++count;
             param_nums[col.name()] = type_codes.size();
             type_codes.push_back(col.type());
             names.push_back(col.name());
         }
     }
-    sql_query += ExpressionList(names).get_sql() + _T(") VALUES (") +
-        ExpressionList(pholders).get_sql() + _T(")");
+    String into = table.name() + _T(" (") +
+        ExpressionList(names).get_sql() + _T(")");
+    String sql_query = _T("INSERT ALL");
+    if (insert_model != INSERT_ALL || n_rows == 1) {
+        sql_query = _T("INSERT INTO ") + into;
+        if (returning_model == RETURNING_OUTPUT_INTO)
+            sql_query = _T("SET NOCOUNT ON; ")
+                _T("DECLARE @NEW_IDS TABLE (ID BIGINT); ")
+                + sql_query + _T(" OUTPUT INSERTED.")
+                + table.get_surrogate_pk() + _T(" INTO @NEW_IDS");
+        sql_query += _T(" VALUES");
+    }
+    size_t n_cols = names.size();
+    for (int row = 0; row < n_rows; ++row) {
+        Strings pholders;
+        for (i = 0; i < n_cols; ++i, ++count) {
+            if (numbered_params)
+                pholders.push_back(_T(":") + to_string(count));
+            else
+                pholders.push_back(_T("?"));
+        }
+        if (insert_model == INSERT_ALL && n_rows > 1)
+            sql_query += _T(" INTO ") + into + _T(" VALUES");
+        else if (row)
+            sql_query += _T(",");
+        sql_query += _T(" (") + ExpressionList(pholders).get_sql() + _T(")");
+    }
+    TypeCodes row_codes(type_codes);
+    for (int row = 1; row < n_rows; ++row)
+        type_codes.insert(type_codes.end(), row_codes.begin(), row_codes.end());
+    if (insert_model == INSERT_ALL && n_rows > 1)
+        sql_query += _T(" SELECT * FROM DUAL");
+    else if (returning_model == RETURNING_CLAUSE)
+        sql_query += _T(" RETURNING ") + table.get_surrogate_pk();
+    else if (returning_model == RETURNING_OUTPUT_INTO)
+        sql_query += _T("; SET NOCOUNT OFF; SELECT ID FROM @NEW_IDS");
     str_swap(sql, sql_query);
     type_codes_out.swap(type_codes);
     param_nums_out.swap(param_nums);
@@ -353,7 +664,8 @@ EngineBase::gen_sql_insert(String &sql, TypeCodes &type_codes_out,
 void
 EngineBase::gen_sql_update(String &sql, TypeCodes &type_codes_out,
         ParamNums &param_nums_out, const Table &table,
-        const SqlGeneratorOptions &options)
+        const SqlGeneratorOptions &options,
+        const vector<bool> *columns)
 {
     if (!table.pk_fields().size())
         throw BadSQLOperation(_T("cannot build update statement: no key in table"));
@@ -365,7 +677,9 @@ EngineBase::gen_sql_update(String &sql, TypeCodes &type_codes_out,
     size_t i;
     for (i = 0; i < table.size(); ++i) {
         const Column &col = table[i];
-        if (!col.is_pk() && !col.is_ro()) {
+        if (!col.is_pk() && !col.is_ro() &&
+                (!columns || (*columns)[i]))
+        {
             if (!type_codes.empty())
                 sql_query += _T(", ");
             sql_query += col.name() + _T(" = ");
@@ -394,7 +708,8 @@ EngineBase::gen_sql_update(String &sql, TypeCodes &type_codes_out,
 
 void
 EngineBase::gen_sql_delete(String &sql, TypeCodes &type_codes_out,
-        const Table &table, const SqlGeneratorOptions &options)
+        const Table &table, const SqlGeneratorOptions &options,
+        int n_keys)
 {
     if (!table.pk_fields().size())
         throw BadSQLOperation(_T("cannot build update statement: no key in table"));
@@ -403,8 +718,18 @@ EngineBase::gen_sql_delete(String &sql, TypeCodes &type_codes_out,
     TypeCodes type_codes;
     Key sample_key;
     table.mk_sample_key(type_codes, sample_key);
-    sql_query += _T(" WHERE ")
-        + KeyFilter(sample_key).generate_sql(options, &ctx);
+    if (n_keys > 1) {
+        Keys sample_keys(n_keys, sample_key);
+        TypeCodes key_codes(type_codes);
+        for (int i = 1; i < n_keys; ++i)
+            type_codes.insert(type_codes.end(),
+                    key_codes.begin(), key_codes.end());
+        sql_query += _T(" WHERE ")
+            + KeysFilter(sample_keys).generate_sql(options, &ctx);
+    }
+    else
+        sql_query += _T(" WHERE ")
+            + KeyFilter(sample_key).generate_sql(options, &ctx);
     type_codes_out.swap(type_codes);
     str_swap(sql, sql_query);
 }
@@ -367,7 +367,7 @@ JoinExprBackend::generate_sql(
     else
         sql += sql_parentheses_as_needed(
                 expr1_.generate_sql(options, ctx));
-    sql += _T(" JOIN ");
+    sql += outer_? _T(" LEFT JOIN "): _T(" JOIN ");
     if (expr2_.backend() &&
             (dynamic_cast<JoinExprBackend *>(expr2_.backend()) ||
              dynamic_cast<ColumnExprBackend *>(expr2_.backend())))
@@ -382,8 +382,8 @@ JoinExprBackend::generate_sql(
 }
 
 JoinExpr::JoinExpr(const Expression &expr1,
-        const Expression &expr2, const Expression &cond)
-    : Expression(ExprBEPtr(new JoinExprBackend(expr1, expr2, cond)))
+        const Expression &expr2, const Expression &cond, bool outer)
+    : Expression(ExprBEPtr(new JoinExprBackend(expr1, expr2, cond, outer)))
 {}
 
 const Expression &
@@ -416,6 +416,11 @@ JoinExpr::cond() {
     return checked_dynamic_cast<JoinExprBackend *>(backend_.get())->cond();
 }
 
+bool
+JoinExpr::outer() const {
+    return checked_dynamic_cast<JoinExprBackend *>(backend_.get())->outer();
+}
+
 const String
 ExpressionListBackend::generate_sql(
         const SqlGeneratorOptions &options,
@@ -1043,6 +1048,64 @@ KeyFilter::expr()
     return checked_dynamic_cast<FilterBackendByPK *>(backend_.get())->expr();
 }
 
+const Expression
+FilterBackendByKeys::build_expr(const Keys &keys)
+{
+    if (keys.size() == 1)
+        return FilterBackendByPK::build_expr(keys[0]);
+    Expression expr;
+    if (!keys.size())
+        return expr;
+    if (keys[0].id_name) {
+        ExpressionList values;
+        Keys::const_iterator i = keys.begin(), iend = keys.end();
+        for (; i != iend; ++i)
+            values << ConstExpr(i->id_value);
+        expr = ColumnExpr(*keys[0].table, *keys[0].id_name).in_(values);
+    }
+    else {
+        Keys::const_iterator i = keys.begin(), iend = keys.end();
+        for (; i != iend; ++i)
+            expr = expr || FilterBackendByPK::build_expr(*i);
+    }
+    return expr;
+}
+
+FilterBackendByKeys::FilterBackendByKeys(const Keys &keys)
+    : expr_(build_expr(keys))
+    , keys_(keys)
+{}
+
+const String
+FilterBackendByKeys::generate_sql(
+        const SqlGeneratorOptions &options,
+        SqlGeneratorContext *ctx) const
+{
+    return expr_.generate_sql(options, ctx);
+}
+
+KeysFilter::KeysFilter(const Keys &keys)
+    : Expression(ExprBEPtr(new FilterBackendByKeys(keys)))
+{}
+
+const Keys &
+KeysFilter::keys() const
+{
+    return checked_dynamic_cast<FilterBackendByKeys *>(backend_.get())->keys();
+}
+
+const Expression &
+KeysFilter::expr() const
+{
+    return checked_dynamic_cast<FilterBackendByKeys *>(backend_.get())->expr();
+}
+
+Expression &
+KeysFilter::expr()
+{
+    return checked_dynamic_cast<FilterBackendByKeys *>(backend_.get())->expr();
+}
+
 YBORM_DECL void
 find_all_tables(const Expression &expr, Strings &tables)
 {
@@ -1132,9 +1195,14 @@ set_table_aliases_on_cond(Expression &expr, const string_map &aliases)
         else {
             FilterBackendByPK *key_expr =
                 dynamic_cast<FilterBackendByPK *> (expr.backend());
+            FilterBackendByKeys *keys_expr =
+                dynamic_cast<FilterBackendByKeys *> (expr.backend());
             if (key_expr) {
                 set_table_aliases_on_cond(key_expr->expr(), aliases);
             }
+            else if (keys_expr) {
+                set_table_aliases_on_cond(keys_expr->expr(), aliases);
+            }
             else {
                 UnaryOpExprBackend *un_expr =
                     dynamic_cast<UnaryOpExprBackend *> (expr.backend());
@@ -1189,6 +1257,18 @@ set_table_aliases_on_cols(Expression &expr, const string_map &aliases,
     }
 }
 
+YBORM_DECL void
+add_object_columns(ExpressionList &cols, const Table &table)
+{
+    Columns::const_iterator it = table.begin(), end = table.end();
+    for (; it != end; ++it) {
+        if (it->is_lazy())
+            cols << ColumnExpr(Expression(_T("NULL")), it->name());
+        else
+            cols << ColumnExpr(table.name(), it->name());
+    }
+}
+
 YBORM_DECL SelectExpr
 make_select(const Schema &schema, const Expression &from_where,
         const Expression &filter, const Expression &order_by,
@@ -1199,11 +1279,8 @@ make_select(const Schema &schema, const Expression &from_where,
     find_all_tables(from_where, tables);
     ExpressionList cols;
     Strings::const_iterator i = tables.begin(), iend = tables.end();
-    for (; i != iend; ++i) {
-        const Table &table = schema.table(*i);
-        for (size_t j = 0; j < table.size(); ++j)
-            cols << ColumnExpr(table.name(), table[j].name());
-    }
+    for (; i != iend; ++i)
+        add_object_columns(cols, schema.table(*i));
     SelectExpr q(cols);
     q.from_(from_where).where_(filter).order_by_(order_by)
         .for_update(for_update_flag);
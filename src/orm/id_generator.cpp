@@ -0,0 +1,142 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#define YBORM_SOURCE
+
+#include "util/singleton.h"
+#include "orm/id_generator.h"
+#include "orm/engine.h"
+
+namespace Yb {
+
+IdGeneratorError::IdGeneratorError(const String &name)
+    : MetaDataError(_T("Unknown id generator: ") + name)
+{}
+
+IdGeneratorConflict::IdGeneratorConflict(const String &table_name,
+                                         const String &seq_name)
+    : MetaDataError(_T("Table ") + table_name
+            + _T(" uses another id generator or block for sequence ")
+            + seq_name)
+{}
+
+IdGenerator::~IdGenerator() {}
+
+SequenceIdGenerator::SequenceIdGenerator(const String &seq_name)
+    : seq_name_(seq_name)
+{}
+
+LongInt SequenceIdGenerator::next_id(EngineBase &engine)
+{
+    return engine.get_next_value(seq_name_);
+}
+
+HiLoIdGenerator::HiLoIdGenerator(const String &seq_name, int block)
+    : seq_name_(seq_name)
+    , block_(block > 0? block: 1)
+    , next_(0)
+    , end_(0)
+{}
+
+LongInt HiLoIdGenerator::next_hi(EngineBase &engine)
+{
+    return engine.get_next_value(seq_name_);
+}
+
+LongInt HiLoIdGenerator::next_id(EngineBase &engine)
+{
+    {
+        ScopedLock lock(mutex_);
+        if (next_ != end_)
+            return next_++;
+    }
+    // Don't make the other sessions wait for the query.  If one of
+    // them has got a new block meanwhile, this one is just skipped.
+    LongInt hi = next_hi(engine);
+    ScopedLock lock(mutex_);
+    if (next_ == end_) {
+        next_ = hi * block_;
+        end_ = next_ + block_;
+    }
+    return next_++;
+}
+
+static IdGenerator *create_sequence_generator(const String &seq_name,
+                                              int /* block */)
+{
+    return new SequenceIdGenerator(seq_name);
+}
+
+static IdGenerator *create_hilo_generator(const String &seq_name, int block)
+{
+    return new HiLoIdGenerator(seq_name, block);
+}
+
+class IdGeneratorRegistry: NonCopyable
+{
+    typedef std::map<String, IdGeneratorCreator> Creators;
+    typedef SharedPtr<IdGenerator>::Type IdGeneratorPtr;
+    struct Entry {
+        IdGeneratorPtr gen;
+        String name;
+        int block;
+    };
+    typedef std::map<String, Entry> Generators;
+    Creators creators_;
+    Generators generators_;
+    Mutex mutex_;
+public:
+    IdGeneratorRegistry()
+    {
+        creators_[_T("sequence")] = create_sequence_generator;
+        creators_[_T("hilo")] = create_hilo_generator;
+    }
+
+    void register_creator(const String &name, IdGeneratorCreator creator)
+    {
+        ScopedLock lock(mutex_);
+        creators_[name] = creator;
+    }
+
+    IdGenerator &get(const Table &table, const String &source_id)
+    {
+        String name = str_empty(table.id_generator())?
+            String(_T("sequence")): table.id_generator();
+        // The same sequence of another database is another one
+        String key = source_id + _T(":") + table.seq_name();
+        ScopedLock lock(mutex_);
+        Generators::iterator i = generators_.find(key);
+        if (i != generators_.end()) {
+            // Otherwise the first table to come would decide for all
+            if (i->second.name != name || i->second.block != table.id_block())
+                throw IdGeneratorConflict(table.name(), table.seq_name());
+            return *i->second.gen;
+        }
+        Creators::iterator c = creators_.find(name);
+        if (c == creators_.end())
+            throw IdGeneratorError(name);
+        IdGeneratorPtr gen(c->second(table.seq_name(), table.id_block()));
+        Entry &e = generators_[key];
+        e.gen = gen;
+        e.name = name;
+        e.block = table.id_block();
+        return *e.gen;
+    }
+};
+
+typedef SingletonHolder<IdGeneratorRegistry> IdGeneratorRegistrySingleton;
+
+YBORM_DECL void
+register_id_generator(const String &name, IdGeneratorCreator creator)
+{
+    IdGeneratorRegistrySingleton::instance().register_creator(name, creator);
+}
+
+YBORM_DECL IdGenerator &
+table_id_generator(const Table &table, EngineBase &engine)
+{
+    return IdGeneratorRegistrySingleton::instance().get(
+            table, engine.get_conn()->get_source().id());
+}
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
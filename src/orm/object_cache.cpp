@@ -0,0 +1,158 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#define YBORM_SOURCE
+
+#include "util/singleton.h"
+#include "orm/object_cache.h"
+
+namespace Yb {
+
+ObjectCache::ObjectCache()
+    : hits_(0)
+    , misses_(0)
+{}
+
+void ObjectCache::erase(TableCache &tc, Entries::iterator i)
+{
+    tc.lru.erase(i->second.lru_pos);
+    tc.entries.erase(i);
+}
+
+void ObjectCache::erase(TableCache &tc, const String &key_str)
+{
+    Entries::iterator i = tc.entries.find(key_str);
+    if (i != tc.entries.end())
+        erase(tc, i);
+}
+
+bool ObjectCache::get(const String &source, const Table &table,
+                      const Key &key, Values &values)
+{
+    String key_str = key2str(key);
+    ScopedLock lock(mutex_);
+    TableCaches::iterator t = tables_.find(
+            std::make_pair(source, table.name()));
+    if (t != tables_.end()) {
+        TableCache &tc = t->second;
+        Entries::iterator i = tc.entries.find(key_str);
+        if (i != tc.entries.end() && !tc.locks.count(key_str)) {
+            if (i->second.expires > time(NULL)) {
+                tc.lru.splice(tc.lru.begin(), tc.lru, i->second.lru_pos);
+                values = i->second.values;
+                ++hits_;
+                return true;
+            }
+            erase(tc, i);
+        }
+    }
+    ++misses_;
+    return false;
+}
+
+unsigned long ObjectCache::stamp(const String &source, const Table &table)
+{
+    ScopedLock lock(mutex_);
+    TableCaches::const_iterator t = tables_.find(
+            std::make_pair(source, table.name()));
+    return t != tables_.end()? t->second.stamp: 0;
+}
+
+void ObjectCache::put(const String &source, const Table &table,
+                      const Key &key, const Values &values,
+                      unsigned long stamp)
+{
+    if (!table.cached())
+        return;
+    String key_str = key2str(key);
+    ScopedLock lock(mutex_);
+    TableCache &tc = tables_[std::make_pair(source, table.name())];
+    // The row may have been loaded before a change got committed
+    if (tc.stamp != stamp || tc.locks.count(key_str))
+        return;
+    Entries::iterator i = tc.entries.find(key_str);
+    if (i == tc.entries.end()) {
+        while (tc.entries.size() >= (size_t)table.cache_size())
+            erase(tc, tc.entries.find(tc.lru.back()));
+        tc.lru.push_front(key_str);
+        i = tc.entries.insert(Entries::value_type(key_str, Entry())).first;
+        i->second.lru_pos = tc.lru.begin();
+    }
+    else
+        tc.lru.splice(tc.lru.begin(), tc.lru, i->second.lru_pos);
+    i->second.values = values;
+    i->second.expires = time(NULL) + table.cache_ttl();
+}
+
+void ObjectCache::remove(const String &source, const Table &table,
+                         const Key &key)
+{
+    String key_str = key2str(key);
+    ScopedLock lock(mutex_);
+    TableCaches::iterator t = tables_.find(
+            std::make_pair(source, table.name()));
+    if (t != tables_.end())
+        erase(t->second, key_str);
+}
+
+void ObjectCache::lock(const String &source, const Table &table,
+                       const Key &key)
+{
+    String key_str = key2str(key);
+    ScopedLock lock(mutex_);
+    TableCache &tc = tables_[std::make_pair(source, table.name())];
+    ++tc.locks[key_str];
+    erase(tc, key_str);
+}
+
+void ObjectCache::unlock(const String &source, const Table &table,
+                         const Key &key)
+{
+    String key_str = key2str(key);
+    ScopedLock lock(mutex_);
+    TableCache &tc = tables_[std::make_pair(source, table.name())];
+    LockCounts::iterator i = tc.locks.find(key_str);
+    if (i != tc.locks.end() && !--i->second)
+        tc.locks.erase(i);
+    erase(tc, key_str);
+    ++tc.stamp;
+}
+
+void ObjectCache::clear()
+{
+    ScopedLock lock(mutex_);
+    tables_.clear();
+    hits_ = misses_ = 0;
+}
+
+size_t ObjectCache::size()
+{
+    ScopedLock lock(mutex_);
+    size_t n = 0;
+    TableCaches::const_iterator t = tables_.begin(), tend = tables_.end();
+    for (; t != tend; ++t)
+        n += t->second.entries.size();
+    return n;
+}
+
+size_t ObjectCache::hits()
+{
+    ScopedLock lock(mutex_);
+    return hits_;
+}
+
+size_t ObjectCache::misses()
+{
+    ScopedLock lock(mutex_);
+    return misses_;
+}
+
+typedef SingletonHolder<ObjectCache> ObjectCacheSingleton;
+
+YBORM_DECL ObjectCache &
+theObjectCache()
+{
+    return ObjectCacheSingleton::instance();
+}
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
@@ -0,0 +1,108 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#define YBORM_SOURCE
+
+#include "orm/query_cache.h"
+
+namespace Yb {
+
+QueryCache::QueryCache()
+    : enabled_(true)
+    , max_size_(YB_QUERY_CACHE_SIZE)
+    , hits_(0)
+    , misses_(0)
+{}
+
+void QueryCache::shrink(size_t max_size)
+{
+    while (entries_.size() > max_size) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
+
+bool QueryCache::get(const String &key, CompiledQuery &query)
+{
+    ScopedLock lock(mutex_);
+    Entries::iterator i = entries_.find(key);
+    if (i == entries_.end()) {
+        ++misses_;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, i->second.lru_pos);
+    query = i->second.query;
+    ++hits_;
+    return true;
+}
+
+void QueryCache::put(const String &key, const CompiledQuery &query)
+{
+    ScopedLock lock(mutex_);
+    if (!enabled_ || !max_size_)
+        return;
+    Entries::iterator i = entries_.find(key);
+    if (i == entries_.end()) {
+        shrink(max_size_ - 1);
+        lru_.push_front(key);
+        i = entries_.insert(Entries::value_type(key, Entry())).first;
+        i->second.lru_pos = lru_.begin();
+    }
+    else
+        lru_.splice(lru_.begin(), lru_, i->second.lru_pos);
+    i->second.query = query;
+}
+
+void QueryCache::set_enabled(bool enabled)
+{
+    ScopedLock lock(mutex_);
+    enabled_ = enabled;
+    if (!enabled_)
+        shrink(0);
+}
+
+bool QueryCache::enabled()
+{
+    ScopedLock lock(mutex_);
+    return enabled_;
+}
+
+void QueryCache::set_max_size(size_t max_size)
+{
+    ScopedLock lock(mutex_);
+    max_size_ = max_size;
+    shrink(max_size_);
+}
+
+size_t QueryCache::max_size()
+{
+    ScopedLock lock(mutex_);
+    return max_size_;
+}
+
+void QueryCache::clear()
+{
+    ScopedLock lock(mutex_);
+    shrink(0);
+    hits_ = misses_ = 0;
+}
+
+size_t QueryCache::size()
+{
+    ScopedLock lock(mutex_);
+    return entries_.size();
+}
+
+size_t QueryCache::hits()
+{
+    ScopedLock lock(mutex_);
+    return hits_;
+}
+
+size_t QueryCache::misses()
+{
+    ScopedLock lock(mutex_);
+    return misses_;
+}
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
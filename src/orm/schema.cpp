@@ -135,9 +135,14 @@ Table::Table(const String &name, const String &xml_name,
     , xml_name_(mk_xml_name(name, xml_name))
     , class_name_(class_name)
     , autoinc_(false)
+    , id_block_(YB_ID_BLOCK)
     , depth_(0)
+    , cache_ttl_(0)
+    , cache_size_(0)
     , schema_(NULL)
-{}
+{
+    reset_rel_count();
+}
 
 void
 Table::add_column(const Column &column)
@@ -159,8 +164,14 @@ Table::add_column(const Column &column)
         cols_[idx] = column;
     }
     cols_[idx].set_table(*this);
-    if (column.is_pk())
+    {
+        ScopedLock lock(dml_plans_mutex_);
+        dml_plans_.clear();
+    }
+    if (column.is_pk()) {
         pk_fields_.push_back(column.name());
+        pk_idx_.push_back(idx);
+    }
 }
 
 size_t
@@ -215,6 +226,28 @@ Table::find_fk_for(const Relation &rel, Strings &fkey_parts) const
     return fkey_parts;
 }
 
+const DmlPlan *
+Table::find_dml_plan(const String &key) const
+{
+    ScopedLock lock(dml_plans_mutex_);
+    DmlPlans::const_iterator i = dml_plans_.find(key);
+    if (i == dml_plans_.end())
+        return NULL;
+    return &i->second;
+}
+
+const DmlPlan *
+Table::add_dml_plan(const String &key, const DmlPlan &plan) const
+{
+    ScopedLock lock(dml_plans_mutex_);
+    DmlPlans::const_iterator i = dml_plans_.find(key);
+    if (i != dml_plans_.end())
+        return &i->second;
+    if (dml_plans_.size() >= YB_MAX_DML_PLANS)
+        return NULL;
+    return &dml_plans_.insert(DmlPlans::value_type(key, plan)).first->second;
+}
+
 void
 Table::mk_sample_key(TypeCodes &type_codes, Key &sample_key) const
 {
@@ -246,9 +279,9 @@ Table::mk_key(const Values &row_values, Key &key) const
 {
     if (pk_fields().size() == 1) {
         const String &pk_name = pk_fields()[0];
-        int col_type = column(pk_name).type();
+        int col_type = cols_[pk_idx_[0]].type();
         if (col_type == Value::INTEGER || col_type == Value::LONGINT) {
-            const Value &x = row_values[idx_by_name(pk_name)];
+            const Value &x = row_values[pk_idx_[0]];
             key.reset(&name(), &pk_name,
                       x.is_null()? 0: x.as_longint(), x.is_null());
             return !x.is_null();
@@ -259,8 +292,8 @@ Table::mk_key(const Values &row_values, Key &key) const
     ValueMap key_values;
     key_values.reserve(pk_fields().size());
     Strings::const_iterator i = pk_fields().begin(), iend = pk_fields().end();
-    for (; i != iend; ++i) {
-        const Value &x = row_values[idx_by_name(*i)];
+    for (size_t j = 0; i != iend; ++i, ++j) {
+        const Value &x = row_values[pk_idx_[j]];
         key_values.push_back(make_pair(&*i, x));
         if (x.is_null())
             assigned_key = false;
@@ -269,14 +302,53 @@ Table::mk_key(const Values &row_values, Key &key) const
     return assigned_key;
 }
 
+bool
+Table::same_key(const Values &row_values, const Key &key) const
+{
+    if (!key.table || (key.table != &name() && *key.table != name()))
+        return false;
+    if (key.id_name) {
+        if (pk_idx_.size() != 1 || *key.id_name != pk_fields()[0])
+            return false;
+        int col_type = cols_[pk_idx_[0]].type();
+        if (col_type != Value::INTEGER && col_type != Value::LONGINT)
+            return false;
+        const Value &x = row_values[pk_idx_[0]];
+        if (x.is_null() || key.id_is_null)
+            return x.is_null() && key.id_is_null;
+        return x.as_longint() == key.id_value;
+    }
+    if (key.fields.size() != pk_idx_.size())
+        return false;
+    if (pk_idx_.size() == 1) {
+        int col_type = cols_[pk_idx_[0]].type();
+        if (col_type == Value::INTEGER || col_type == Value::LONGINT)
+            return false;
+    }
+    for (size_t j = 0; j < pk_idx_.size(); ++j)
+        if (*key.fields[j].first != pk_fields()[j] ||
+                row_values[pk_idx_[j]].cmp(key.fields[j].second))
+            return false;
+    return true;
+}
+
+bool
+Table::same_key(const Values &row_values1, const Values &row_values2) const
+{
+    for (size_t j = 0; j < pk_idx_.size(); ++j)
+        if (row_values1[pk_idx_[j]].cmp(row_values2[pk_idx_[j]]))
+            return false;
+    return true;
+}
+
 bool
 Table::mk_key(const Row &row_values, Key &key) const
 {
     if (pk_fields().size() == 1) {
         const String &pk_name = pk_fields()[0];
-        int col_type = column(pk_name).type();
+        int col_type = cols_[pk_idx_[0]].type();
         if (col_type == Value::INTEGER || col_type == Value::LONGINT) {
-            const Value &x = row_values[idx_by_name(pk_name)].second;
+            const Value &x = row_values[pk_idx_[0]].second;
             key.reset(&name(), &pk_name,
                       x.is_null()? 0: x.as_longint(), x.is_null());
             return !x.is_null();
@@ -287,8 +359,8 @@ Table::mk_key(const Row &row_values, Key &key) const
     ValueMap key_values;
     key_values.reserve(pk_fields().size());
     Strings::const_iterator i = pk_fields().begin(), iend = pk_fields().end();
-    for (; i != iend; ++i) {
-        const Value &x = row_values[idx_by_name(*i)].second;
+    for (size_t j = 0; i != iend; ++i, ++j) {
+        const Value &x = row_values[pk_idx_[j]].second;
         key_values.push_back(make_pair(&*i, x));
         if (x.is_null())
             assigned_key = false;
@@ -332,6 +404,8 @@ Relation::Relation(int _type,
     , attr2_(_attr2)
     , table1_(NULL)
     , table2_(NULL)
+    , ordinal1_(-1)
+    , ordinal2_(-1)
 {
 /*
     std::cerr << "Relation::Relation(): "
@@ -431,6 +505,8 @@ Schema::operator=(Schema &x)
         rels_.swap(x.rels_);
         relations_.swap(x.relations_);
         fix_backrefs();
+        query_cache_.clear();
+        x.query_cache_.clear();
     }
     return *this;
 }
@@ -447,6 +523,7 @@ Schema::add_table(Table::Ptr table)
     tables_lookup_[str_to_upper(table->name())] = table;
     tables_lookup_[str_to_lower(table->name())] = table;
     table->set_schema(this);
+    query_cache_.clear();
 }
 
 const Table &
@@ -504,12 +581,16 @@ Schema::fill_fkeys()
             }
         }
     }
+    query_cache_.clear();
+    for (i = tables_.begin(); i != iend; ++i)
+        i->second->reset_rel_count();
     RelVect::iterator l = relations_.begin(), lend = relations_.end();
     for (; l != lend; ++l) {
         Relation &r = **l;
         Table *t0 = const_cast<Table *> (&find_table_by_class(r.side(0))),
               *t1 = const_cast<Table *> (&find_table_by_class(r.side(1)));
         r.set_tables(t0, t1);
+        r.set_ordinals(t0->add_rel_ordinal(0), t1->add_rel_ordinal(1));
         if (r.type() == Relation::ONE2MANY) {
             const Strings &fkey_parts = r.fk_fields();
             if (!fkey_parts.size() || fkey_parts.size() != t0->pk_fields().size())
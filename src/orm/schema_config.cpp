@@ -103,8 +103,10 @@ void MetaDataConfig::parse(Schema &reg)
 
 Table::Ptr MetaDataConfig::parse_table(ElementTree::ElementPtr node)
 {
-    String sequence_name, name, xml_name, class_name;
+    String sequence_name, name, xml_name, class_name, id_generator;
     bool autoinc = false;
+    int id_block = YB_ID_BLOCK;
+    int cache_ttl = 0, cache_size = 0;
 
     if (!node->has_attr(_T("name")))
         throw MandatoryAttributeAbsent(_T("table"), _T("name"));
@@ -116,6 +118,20 @@ Table::Ptr MetaDataConfig::parse_table(ElementTree::ElementPtr node)
     if (node->has_attr(_T("autoinc")))
         autoinc = true;
 
+    if (node->has_attr(_T("id-generator")))
+        id_generator = node->get_attr(_T("id-generator"));
+    if (node->has_attr(_T("id-block")))
+        from_string(node->get_attr(_T("id-block")), id_block);
+
+    if (node->has_attr(_T("cache-ttl")) || node->has_attr(_T("cache-size"))) {
+        cache_ttl = YB_CACHE_TTL;
+        cache_size = YB_CACHE_SIZE;
+        if (node->has_attr(_T("cache-ttl")))
+            from_string(node->get_attr(_T("cache-ttl")), cache_ttl);
+        if (node->has_attr(_T("cache-size")))
+            from_string(node->get_attr(_T("cache-size")), cache_size);
+    }
+
     if (node->has_attr(_T("xml-name")))
         xml_name = node->get_attr(_T("xml-name"));
     else
@@ -129,6 +145,8 @@ Table::Ptr MetaDataConfig::parse_table(ElementTree::ElementPtr node)
     Table::Ptr table_meta(new Table(name, xml_name, class_name));
     table_meta->set_seq_name(sequence_name);
     table_meta->set_autoinc(autoinc);
+    table_meta->set_id_generator(id_generator, id_block);
+    table_meta->set_cache(cache_ttl, cache_size);
 
     parse_column(node, *table_meta);
     return table_meta;
@@ -291,6 +309,8 @@ Column MetaDataConfig::fill_column_meta(ElementTree::ElementPtr node)
     for (; child != cend; ++child) {
         if (!(*child)->name_.compare(_T("read-only")))
             flags |= Column::RO;
+        if (!(*child)->name_.compare(_T("lazy")))
+            flags |= Column::LAZY;
         if (!(*child)->name_.compare(_T("primary-key")))
             flags |= Column::PK;
         if (!(*child)->name_.compare(_T("foreign-key"))) {
@@ -352,6 +372,8 @@ ElementTree::ElementPtr MetaDataConfig::column_to_tree(const Column &column)
         node->attrib_[_T("null")] = _T("false");
     if (column.is_ro())
         node->sub_element(_T("read-only"));
+    if (column.is_lazy())
+        node->sub_element(_T("lazy"));
     if (column.is_pk())
         node->sub_element(_T("primary-key"));
     if (column.has_fk()) {
@@ -379,6 +401,14 @@ ElementTree::ElementPtr MetaDataConfig::table_to_tree(const Table &table)
         node->attrib_[_T("xml-name")] = table.xml_name();
     else if (table.autoinc())
         node->attrib_[_T("autoinc")] = _T("true");
+    if (!str_empty(table.id_generator())) {
+        node->attrib_[_T("id-generator")] = table.id_generator();
+        node->attrib_[_T("id-block")] = to_string(table.id_block());
+    }
+    if (table.cached()) {
+        node->attrib_[_T("cache-ttl")] = to_string(table.cache_ttl());
+        node->attrib_[_T("cache-size")] = to_string(table.cache_size());
+    }
     Columns::const_iterator it = table.begin(), end = table.end();
     for (; it != end; ++it)
         node->children_.push_back(column_to_tree(*it));
@@ -80,6 +80,29 @@ SqlDriverError::SqlDriverError(const String &msg)
     : DBError(msg)
 {}
 
+static const String format_failed_rows(const std::vector<size_t> &rows)
+{
+    String s;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i)
+            s += _T(", ");
+        s += to_string(rows[i]);
+    }
+    return s;
+}
+
+ShortBlobStream::ShortBlobStream()
+    : RunTimeError(_T("Unexpected end of the BLOB stream"))
+{}
+
+BatchExecError::BatchExecError(const String &reason,
+                               const std::vector<size_t> &failed_rows)
+    : DBError(_T("Batch failed at rows [") + format_failed_rows(failed_rows)
+              + _T("]: ") + reason)
+    , reason_(reason)
+    , failed_rows_(failed_rows)
+{}
+
 SqlDialect::~SqlDialect() {}
 
 bool
@@ -127,6 +150,21 @@ SqlDialect::grant_insert_id_statement(const String &table_name, bool on)
 bool
 SqlDialect::explicit_null() { return false; }
 
+int
+SqlDialect::max_params() { return 1000; }
+
+int
+SqlDialect::insert_model() { return (int)INSERT_ONE_ROW; }
+
+int
+SqlDialect::max_insert_rows() { return 1000; }
+
+int
+SqlDialect::returning_model() { return (int)RETURNING_NONE; }
+
+bool
+SqlDialect::consecutive_insert_ids() { return false; }
+
 const String
 SqlDialect::not_null_default(const String &not_null_clause,
         const String &default_value)
@@ -267,11 +305,80 @@ list_sql_drivers()
     return theDriverRegistry::instance().list_items();
 }
 
+RowHeader::RowHeader(const Strings &names)
+    : names_(names)
+{
+    for (size_t i = 0; i < names_.size(); ++i)
+        idx_.insert(std::make_pair(names_[i], (int)i));
+}
+
+int
+RowHeader::idx_by_name(const String &name) const
+{
+    std::map<String, int>::const_iterator i = idx_.find(name);
+    return i == idx_.end()? -1: i->second;
+}
+
 SqlCursorBackend::~SqlCursorBackend() {}
 
 void
 SqlCursorBackend::bind_params(const TypeCodes &types) {}
 
+bool
+SqlCursorBackend::last_insert_id(LongInt &id) { return false; }
+
+void
+SqlCursorBackend::reset() {}
+
+void
+SqlCursorBackend::exec_batch(const std::vector<Values> &params_rows)
+{
+    for (size_t i = 0; i < params_rows.size(); ++i) {
+        try {
+            exec(params_rows[i]);
+        }
+        catch (const std::exception &e) {
+            throw BatchExecError(WIDEN(e.what()),
+                                 std::vector<size_t>(1, i));
+        }
+    }
+}
+
+bool
+SqlCursorBackend::blob_streams() { return false; }
+
+bool
+SqlCursorBackend::read_blob(const String &table, const String &column,
+        const String &where, const Values &params, std::ostream &out)
+{
+    throw SqlDriverError(_T("BLOB streams are not supported"));
+}
+
+void
+SqlCursorBackend::write_blob(const String &table, const String &column,
+        const String &where, const Values &params,
+        std::istream &in, LongInt size)
+{
+    throw SqlDriverError(_T("BLOB streams are not supported"));
+}
+
+bool
+SqlCursorBackend::fetch_values(Values &values, Strings *names)
+{
+    RowPtr row = fetch_row();
+    if (!row.get())
+        return false;
+    values.resize(row->size());
+    if (names)
+        names->resize(row->size());
+    for (size_t i = 0; i < row->size(); ++i) {
+        values[i].swap((*row)[i].second);
+        if (names)
+            (*names)[i].swap((*row)[i].first);
+    }
+    return true;
+}
+
 SqlConnectionBackend::~SqlConnectionBackend() {}
 
 SqlDriver::~SqlDriver() {}
@@ -399,10 +506,19 @@ SqlSource::options() const
 bool
 SqlResultSet::fetch(Row &row)
 {
-    RowPtr p = cursor_.fetch_row();
-    if (!p.get())
+    // The row buffer is reused, the names are already there
+    // unless it is a fresh one
+    if (!cursor_.fetch_values(values_))
         return false;
-    row.swap(*p);
+    const RowHeader &header = *cursor_.header();
+    size_t n = values_.size();
+    if (row.size() != n)
+        row.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (row[i].first != header.name(i))
+            row[i].first = header.name(i);
+        row[i].second.swap(values_[i]);
+    }
     return true;
 }
 
@@ -413,14 +529,53 @@ SqlResultSet::own(std::auto_ptr<SqlCursor> cursor)
     owned_cursor_.reset(cursor.release());
 }
 
+bool
+SqlResultSet::fetch_values(Values &values)
+{
+    return cursor_.fetch_values(values);
+}
+
+const RowHeaderPtr &
+SqlResultSet::header() const
+{
+    return cursor_.header();
+}
+
 SqlCursor::SqlCursor(SqlConnection &connection)
     : connection_(connection)
-    , backend_(connection.backend_->new_cursor().release())
     , echo_(connection.echo_)
     , conv_params_(connection.conv_params_)
     , log_(connection.log_.get())
 {}
 
+SqlCursor::~SqlCursor()
+{
+    try {
+        release_stmt();
+    }
+    catch (const std::exception &) {
+        // the statement is just closed then
+    }
+}
+
+SqlCursorBackend *
+SqlCursor::backend()
+{
+    if (!backend_.get())
+        backend_.reset(connection_.backend_->new_cursor().release());
+    return backend_.get();
+}
+
+void
+SqlCursor::release_stmt()
+{
+    if (!str_empty(sql_) && backend_.get() && !connection_.bad_) {
+        backend_->reset();
+        connection_.put_stmt(sql_, backend_.release());
+    }
+    sql_ = String();
+}
+
 void
 SqlCursor::exec_direct(const String &sql)
 {
@@ -428,7 +583,9 @@ SqlCursor::exec_direct(const String &sql)
         if (echo_)
             debug(_T("exec_direct: ") + sql, ll_INFO);
         connection_.activity_ = true;
-        backend_->exec_direct(sql);
+        release_stmt();
+        header_ = RowHeaderPtr();
+        backend()->exec_direct(sql);
     }
     catch (const std::exception &e) {
         connection_.mark_bad(e);
@@ -445,10 +602,21 @@ SqlCursor::prepare(const String &sql)
         String fixed_sql = sql;
         if (conv_params_ && connection_.driver_->numbered_params())
             fixed_sql = SqlDriver::convert_to_numbered_params(sql);
+        connection_.activity_ = true;
+        if (connection_.stmt_cache_size_ > 0) {
+            release_stmt();
+            SqlCursorBackend *cached = connection_.take_stmt(fixed_sql);
+            sql_ = fixed_sql;
+            if (cached) {
+                backend_.reset(cached);
+                if (echo_)
+                    debug(_T("prepare (cached): ") + fixed_sql, ll_INFO);
+                return;
+            }
+        }
         if (echo_)
             debug(_T("prepare: ") + fixed_sql, ll_INFO);
-        connection_.activity_ = true;
-        backend_->prepare(fixed_sql);
+        backend()->prepare(fixed_sql);
     }
     catch (const std::exception &e) {
         connection_.mark_bad(e);
@@ -469,7 +637,7 @@ SqlCursor::bind_params(const TypeCodes &types)
             }
             debug(_T("bind: (") + type_names + _T(")"), ll_TRACE);
         }
-        backend_->bind_params(types);
+        backend()->bind_params(types);
     }
     catch (const std::exception &e) {
         connection_.mark_bad(e);
@@ -490,7 +658,8 @@ SqlCursor::exec(const Values &params)
             debug(WIDEN(out.str()));
         }
         connection_.activity_ = true;
-        backend_->exec(params);
+        header_ = RowHeaderPtr();
+        backend()->exec(params);
         return SqlResultSet(*this);
     }
     catch (const std::exception &e) {
@@ -499,34 +668,39 @@ SqlCursor::exec(const Values &params)
     }
 }
 
-RowPtr
-SqlCursor::fetch_row()
+bool
+SqlCursor::fetch_values(Values &values)
 {
     try {
-        RowPtr row = backend_->fetch_row();
-        if (row.get()) {
-            Row::iterator j = row->begin(), jend = row->end();
-            for (; j != jend; ++j) {
-                String uname = str_to_upper(j->first);
-                using namespace std;
-                swap(j->first, uname);
+        bool found;
+        if (!header_.get()) {
+            Strings names;
+            found = backend()->fetch_values(values, &names);
+            if (found) {
+                Strings::iterator j = names.begin(), jend = names.end();
+                for (; j != jend; ++j) {
+                    String uname = str_to_upper(*j);
+                    using namespace std;
+                    swap(*j, uname);
+                }
+                header_ = RowHeaderPtr(new RowHeader(names));
             }
         }
+        else
+            found = backend()->fetch_values(values, NULL);
         if (echo_) {
-            if (row.get()) {
+            if (found) {
                 std::ostringstream out;
                 out << "fetch: ";
-                Row::const_iterator j = row->begin(),
-                                    jend = row->end();
-                for (; j != jend; ++j)
-                    out << NARROW(j->first) << "="
-                        << NARROW(j->second.sql_str()) << " ";
+                for (size_t j = 0; j < values.size(); ++j)
+                    out << NARROW(header_->name(j)) << "="
+                        << NARROW(values[j].sql_str()) << " ";
                 debug(WIDEN(out.str()));
             }
             else
                 debug(_T("fetch: no more rows"));
         }
-        return row;
+        return found;
     }
     catch (const std::exception &e) {
         connection_.mark_bad(e);
@@ -534,6 +708,37 @@ SqlCursor::fetch_row()
     }
 }
 
+void
+SqlCursor::exec_batch(const std::vector<Values> &params_rows)
+{
+    try {
+        if (echo_)
+            debug(_T("exec batch: ") + to_string(params_rows.size())
+                  + _T(" parameter sets"));
+        connection_.activity_ = true;
+        header_ = RowHeaderPtr();
+        backend()->exec_batch(params_rows);
+    }
+    catch (const std::exception &e) {
+        connection_.mark_bad(e);
+        throw;
+    }
+}
+
+RowPtr
+SqlCursor::fetch_row()
+{
+    Values values;
+    if (!fetch_values(values))
+        return RowPtr();
+    RowPtr row(new Row(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        (*row)[i].first = header_->name(i);
+        (*row)[i].second.swap(values[i]);
+    }
+    return row;
+}
+
 RowsPtr
 SqlCursor::fetch_rows(int max_rows)
 {
@@ -550,6 +755,102 @@ SqlCursor::fetch_rows(int max_rows)
     }
 }
 
+bool
+SqlCursor::last_insert_id(LongInt &id)
+{
+    try {
+        bool found = backend()->last_insert_id(id);
+        if (found && echo_)
+            debug(_T("last insert id: ") + to_string(id));
+        return found;
+    }
+    catch (const std::exception &e) {
+        connection_.mark_bad(e);
+        throw;
+    }
+}
+
+bool
+SqlCursor::read_blob(const String &table, const String &column,
+        const String &where, const Values &params, std::ostream &out)
+{
+    try {
+        if (echo_)
+            debug(_T("read blob: ") + table + _T(".") + column
+                  + _T(" WHERE ") + where);
+        connection_.activity_ = true;
+        release_stmt();
+        header_ = RowHeaderPtr();
+        if (backend()->blob_streams())
+            return backend()->read_blob(table, column, where, params, out);
+    }
+    catch (const NoDataFound &) {
+        throw;
+    }
+    catch (const std::exception &e) {
+        connection_.mark_bad(e);
+        throw;
+    }
+    // The driver can't do it by chunks, fetch the whole value
+    prepare(_T("SELECT ") + column + _T(" FROM ") + table
+            + _T(" WHERE ") + where);
+    exec(params);
+    Values values;
+    if (!fetch_values(values))
+        throw NoDataFound(_T("No row to read the BLOB from"));
+    if (values[0].is_null())
+        return false;
+    const Blob b = values[0].as_blob();
+    if (!b.empty())
+        out.write(&b[0], b.size());
+    return true;
+}
+
+void
+SqlCursor::write_blob(const String &table, const String &column,
+        const String &where, const Values &params,
+        std::istream &in, LongInt size)
+{
+    try {
+        if (echo_)
+            debug(_T("write blob: ") + table + _T(".") + column
+                  + _T(" WHERE ") + where + _T(", ")
+                  + to_string(size) + _T(" bytes"));
+        connection_.activity_ = true;
+        release_stmt();
+        header_ = RowHeaderPtr();
+        if (backend()->blob_streams()) {
+            backend()->write_blob(table, column, where, params, in, size);
+            return;
+        }
+    }
+    catch (const NoDataFound &) {
+        throw;
+    }
+    catch (const ShortBlobStream &) {
+        // Not a failure of the connection
+        throw;
+    }
+    catch (const std::exception &e) {
+        connection_.mark_bad(e);
+        throw;
+    }
+    // The driver can't do it by chunks, send the whole value
+    Blob b((size_t)size);
+    if (size > 0) {
+        in.read(&b[0], size);
+        if (in.gcount() != size)
+            throw ShortBlobStream();
+    }
+    Values all_params;
+    all_params.reserve(params.size() + 1);
+    all_params.push_back(Value(b));
+    all_params.insert(all_params.end(), params.begin(), params.end());
+    prepare(_T("UPDATE ") + table + _T(" SET ") + column
+            + _T(" = ? WHERE ") + where);
+    exec(all_params);
+}
+
 void
 SqlConnection::mark_bad(const std::exception &e)
 {
@@ -561,7 +862,68 @@ SqlConnection::mark_bad(const std::exception &e)
         debug(_T("mark connection bad, because of ") + String(WIDEN(s)),
               ll_WARNING);
         bad_ = true;
+        try {
+            clear_stmt_cache();
+        }
+        catch (const std::exception &) {
+            // the connection is going to be dropped anyway
+        }
+    }
+}
+
+SqlCursorBackend *
+SqlConnection::take_stmt(const String &sql)
+{
+    StmtCache::iterator i = stmt_cache_.find(sql);
+    if (i == stmt_cache_.end()) {
+        ++stmt_cache_misses_;
+        return NULL;
     }
+    ++stmt_cache_hits_;
+    SqlCursorBackend *backend = i->second.backend;
+    stmt_lru_.erase(i->second.lru_pos);
+    stmt_cache_.erase(i);
+    return backend;
+}
+
+void
+SqlConnection::put_stmt(const String &sql, SqlCursorBackend *backend)
+{
+    std::auto_ptr<SqlCursorBackend> p(backend);
+    if (stmt_cache_size_ <= 0 || stmt_cache_.find(sql) != stmt_cache_.end())
+        return;
+    while (stmt_cache_.size() >= (size_t)stmt_cache_size_) {
+        StmtCache::iterator i = stmt_cache_.find(stmt_lru_.back());
+        delete i->second.backend;
+        stmt_cache_.erase(i);
+        stmt_lru_.pop_back();
+    }
+    stmt_lru_.push_front(sql);
+    CachedStmt &stmt = stmt_cache_[sql];
+    stmt.backend = p.release();
+    stmt.lru_pos = stmt_lru_.begin();
+}
+
+void
+SqlConnection::set_stmt_cache_size(int size)
+{
+    stmt_cache_size_ = size;
+    while (stmt_cache_.size() > (size_t)(size > 0? size: 0)) {
+        StmtCache::iterator i = stmt_cache_.find(stmt_lru_.back());
+        delete i->second.backend;
+        stmt_cache_.erase(i);
+        stmt_lru_.pop_back();
+    }
+}
+
+void
+SqlConnection::clear_stmt_cache()
+{
+    StmtCache::iterator i = stmt_cache_.begin(), iend = stmt_cache_.end();
+    for (; i != iend; ++i)
+        delete i->second.backend;
+    stmt_cache_.clear();
+    stmt_lru_.clear();
 }
 
 SqlConnection::SqlConnection(const String &driver_name,
@@ -576,6 +938,9 @@ SqlConnection::SqlConnection(const String &driver_name,
     , bad_(false)
     , explicit_trans_started_(false)
     , free_since_(0)
+    , stmt_cache_size_(YB_STMT_CACHE_SIZE)
+    , stmt_cache_hits_(0)
+    , stmt_cache_misses_(0)
 {
     source_[_T("&driver")] = driver_->get_name();
     backend_.reset(driver_->create_backend().release());
@@ -594,6 +959,9 @@ SqlConnection::SqlConnection(const String &driver_name,
     , bad_(false)
     , explicit_trans_started_(false)
     , free_since_(0)
+    , stmt_cache_size_(YB_STMT_CACHE_SIZE)
+    , stmt_cache_hits_(0)
+    , stmt_cache_misses_(0)
 {
     source_[_T("&driver")] = driver_->get_name();
     backend_.reset(driver_->create_backend().release());
@@ -610,6 +978,9 @@ SqlConnection::SqlConnection(const SqlSource &source)
     , bad_(false)
     , explicit_trans_started_(false)
     , free_since_(0)
+    , stmt_cache_size_(YB_STMT_CACHE_SIZE)
+    , stmt_cache_hits_(0)
+    , stmt_cache_misses_(0)
 {
     source_[_T("&driver")] = driver_->get_name();
     backend_.reset(driver_->create_backend().release());
@@ -626,6 +997,9 @@ SqlConnection::SqlConnection(const String &url)
     , bad_(false)
     , explicit_trans_started_(false)
     , free_since_(0)
+    , stmt_cache_size_(YB_STMT_CACHE_SIZE)
+    , stmt_cache_hits_(0)
+    , stmt_cache_misses_(0)
 {
     source_[_T("&driver")] = driver_->get_name();
     backend_.reset(driver_->create_backend().release());
@@ -637,6 +1011,7 @@ SqlConnection::~SqlConnection()
     bool err = false;
     try {
         clear();
+        clear_stmt_cache();
         if (activity_)
             rollback();
     }
@@ -365,6 +365,32 @@ namespace tiodbc
 		return tmp_storage;
 	}
 
+	// Read a number from the block buffer
+	template<class T>
+	T __get_bound(const void *_ptr, SQLSMALLINT _ctype, const T &error_value, int is_null_flag)
+	{
+		if (is_null_flag)
+			return error_value;
+		switch (_ctype) {
+		case SQL_C_SLONG: {
+			SQLINTEGER x;
+			std::memcpy(&x, _ptr, sizeof(x));
+			return (T)x;
+		}
+		case SQL_C_SBIGINT: {
+			SQLBIGINT x;
+			std::memcpy(&x, _ptr, sizeof(x));
+			return (T)x;
+		}
+		case SQL_C_DOUBLE: {
+			SQLDOUBLE x;
+			std::memcpy(&x, _ptr, sizeof(x));
+			return (T)x;
+		}
+		}
+		return error_value;
+	}
+
 	//! @endcond
 
 	// Not direct contructable
@@ -375,6 +401,8 @@ namespace tiodbc
 		, name(_name)
 		, type(_type)
 		, is_null_flag(-1)
+		, bound_ptr(NULL)
+		, bound_ctype(0)
 	{}
 
 	//! Destructor
@@ -388,6 +416,8 @@ namespace tiodbc
 		, name(r.name)
 		, type(r.type)
 		, is_null_flag(r.is_null_flag)
+		, bound_ptr(r.bound_ptr)
+		, bound_ctype(r.bound_ctype)
 	{}
 
 	// Copy operator
@@ -398,12 +428,19 @@ namespace tiodbc
 		name = r.name;
 		type = r.type;
 		is_null_flag = r.is_null_flag;
+		bound_ptr = r.bound_ptr;
+		bound_ctype = r.bound_ctype;
 		return *this;
 	}
 
 	// Get field as string
 	_tstring field_impl::as_string() const
 	{
+		if (bound_ptr) {
+			if (!is_null_flag && bound_ctype == SQL_C_TCHAR)
+				str_buf = sqltchar2ybstring((const SQLTCHAR *)bound_ptr, "");
+			return str_buf;
+		}
 		if (is_null_flag != -1)
 			return str_buf;
 
@@ -444,42 +481,56 @@ namespace tiodbc
 	// Get field as long
 	long field_impl::as_long() const
 	{
+		if (bound_ptr)
+			return __get_bound<long>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<long>(stmt_h, col_num, SQL_C_SLONG, 0, is_null_flag);
 	}
 
 	// Get field as unsigned long
 	unsigned long field_impl::as_unsigned_long() const
 	{
+		if (bound_ptr)
+			return __get_bound<unsigned long>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<unsigned long>(stmt_h, col_num, SQL_C_ULONG, 0, is_null_flag);
 	}
 
 	// Get field as short
 	short field_impl::as_short() const
 	{
+		if (bound_ptr)
+			return __get_bound<short>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<short>(stmt_h, col_num, SQL_C_SSHORT, 0, is_null_flag);
 	}
 
 	// Get field as unsigned short
 	unsigned short field_impl::as_unsigned_short() const
 	{
+		if (bound_ptr)
+			return __get_bound<unsigned short>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<unsigned short>(stmt_h, col_num, SQL_C_USHORT, 0, is_null_flag);
 	}
 
 	// Get field as long long
 	LongLong field_impl::as_long_long() const
 	{
+		if (bound_ptr)
+			return __get_bound<LongLong>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<LongLong>(stmt_h, col_num, SQL_C_SBIGINT, 0, is_null_flag);
 	}
 
 	// Get field as double
 	double field_impl::as_double() const
 	{
+		if (bound_ptr)
+			return __get_bound<double>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<double>(stmt_h, col_num, SQL_C_DOUBLE, 0, is_null_flag);
 	}
 
 	// Get field as float
 	float field_impl::as_float() const
 	{
+		if (bound_ptr)
+			return __get_bound<float>(bound_ptr, bound_ctype, 0, is_null_flag);
 		return __get_data<float>(stmt_h, col_num, SQL_C_FLOAT, 0, is_null_flag);
 	}
 
@@ -488,6 +539,12 @@ namespace tiodbc
 	{
 		TIMESTAMP_STRUCT def_val;
 		std::memset(&def_val, 0, sizeof(def_val));
+		if (bound_ptr) {
+			if (is_null_flag || bound_ctype != SQL_C_TIMESTAMP)
+				return def_val;
+			std::memcpy(&def_val, bound_ptr, sizeof(def_val));
+			return def_val;
+		}
 		return __get_data<TIMESTAMP_STRUCT>(stmt_h, col_num, SQL_C_TIMESTAMP, def_val, is_null_flag);
 	}
 
@@ -653,6 +710,104 @@ namespace tiodbc
 		set_as_string(_tstring(), true);
 	}
 
+	// Set parameter as binary data sent at execution
+	void param_impl::set_as_binary_at_exec(SQLLEN _size)
+	{
+		// The buffer pointer is handed back by SQLParamData,
+		// the next setter has to bind the parameter again
+		bound_sz = -1;
+		_int_SLOIP = SQL_LEN_DATA_AT_EXEC(_size);
+		__bind_param(stmt_h, par_num, SQL_C_BINARY, SQL_LONGVARBINARY,
+				(void *)(size_t)par_num, _int_SLOIP, (int)_size, 0);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////////
+	// PARAM ARRAY IMPLEMENTATION
+	///////////////////////////////////////////////////////////////////////////////////
+
+	// Constructor
+	param_array::param_array(size_t _rows, SQLSMALLINT _ctype)
+		: c_type(_ctype)
+		, elem_size(0)
+		, ind(_rows, SQL_NULL_DATA)
+	{
+		switch (c_type) {
+		case SQL_C_SBIGINT:
+			elem_size = sizeof(SQLBIGINT);
+			break;
+		case SQL_C_DOUBLE:
+			elem_size = sizeof(SQLDOUBLE);
+			break;
+		case SQL_C_TYPE_TIMESTAMP:
+			elem_size = sizeof(TIMESTAMP_STRUCT);
+			break;
+		default:
+			c_type = SQL_C_TCHAR;
+			strs.resize(_rows);
+		}
+		data.resize(_rows * elem_size);
+	}
+
+	// Set as NULL
+	void param_array::set_as_null(size_t _row)
+	{
+		ind[_row] = SQL_NULL_DATA;
+	}
+
+	// Set as long long
+	void param_array::set_as_long_long(size_t _row, const LongLong & _value)
+	{
+		SQLBIGINT x = _value;
+		std::memcpy(&data[_row * elem_size], &x, sizeof(x));
+		ind[_row] = 0;
+	}
+
+	// Set as double
+	void param_array::set_as_double(size_t _row, const double & _value)
+	{
+		SQLDOUBLE x = _value;
+		std::memcpy(&data[_row * elem_size], &x, sizeof(x));
+		ind[_row] = 0;
+	}
+
+	// Set as DateTime
+	void param_array::set_as_date_time(size_t _row, const TIMESTAMP_STRUCT & _value)
+	{
+		std::memcpy(&data[_row * elem_size], &_value, sizeof(_value));
+		ind[_row] = 0;
+	}
+
+	// Set as string
+	void param_array::set_as_string(size_t _row, const _tstring & _str)
+	{
+		strs[_row] = _str;
+		ind[_row] = SQL_NTS;
+	}
+
+	// Lay the strings out in the buffer, each one takes
+	// the room of the longest one
+	void param_array::fill_strings()
+	{
+		if (c_type != SQL_C_TCHAR)
+			return;
+		std::vector<std::vector<SQLTCHAR> > bufs(strs.size());
+		size_t max_len = 1;
+		for (size_t i = 0; i < strs.size(); ++i) {
+			if (ind[i] == SQL_NULL_DATA)
+				continue;
+			SQLTCHAR_buf buf(ybstring2sqltchar(strs[i], ""));
+			bufs[i].assign(buf.data, buf.data + buf.len);
+			if (buf.len > max_len)
+				max_len = buf.len;
+		}
+		elem_size = max_len * sizeof(SQLTCHAR);
+		data.assign(strs.size() * elem_size, 0);
+		for (size_t i = 0; i < bufs.size(); ++i)
+			if (!bufs[i].empty())
+				std::memcpy(&data[i * elem_size], &bufs[i][0],
+						bufs[i].size() * sizeof(SQLTCHAR));
+	}
+
 	///////////////////////////////////////////////////////////////////////////////////
 	// STATEMENT IMPLEMENTATION
 	///////////////////////////////////////////////////////////////////////////////////
@@ -661,7 +816,11 @@ namespace tiodbc
 	statement::statement()
 		:stmt_h(NULL),
 		b_open(false),
-		b_col_info_needed(false)
+		b_col_info_needed(false),
+		block_size(1),
+		rows_fetched(0),
+		cur_row(0),
+		b_block(false)
 	{
 	}
 
@@ -669,7 +828,11 @@ namespace tiodbc
 	statement::statement(connection & _conn, const _tstring & _stmt)
 		:stmt_h(NULL),
 		b_open(false),
-		b_col_info_needed(false)
+		b_col_info_needed(false),
+		block_size(1),
+		rows_fetched(0),
+		cur_row(0),
+		b_block(false)
 	{
 		prepare(_conn, _stmt);
 	}
@@ -700,16 +863,22 @@ namespace tiodbc
 		return true;
 	}
 
+	// Free the parameters bound with param()
+	void statement::free_params()
+	{
+		param_it it;
+		for(it = m_params.begin();it != m_params.end();it++)
+			delete it->second;
+		m_params.clear();
+	}
+
 	// Close statement
 	void statement::close()
 	{
 		if (is_open())
 		{
 			// Free parameters
-			param_it it;
-			for(it = m_params.begin();it != m_params.end();it++)
-				delete it->second;
-			m_params.clear();
+			free_params();
 
 			// Free result if any
 			free_results();
@@ -718,6 +887,10 @@ namespace tiodbc
 			SQLFreeHandle(SQL_HANDLE_STMT, stmt_h);
 			stmt_h = NULL;
 			b_open = false;
+
+			// The bound buffers go with the handle
+			m_bound.clear();
+			b_block = false;
 		}
 	}
 
@@ -770,6 +943,7 @@ namespace tiodbc
 			return false;
 
 		b_col_info_needed = true;
+		rows_fetched = cur_row = 0;
 		return true;
 	}
 
@@ -792,6 +966,170 @@ namespace tiodbc
 			return false;
 		}
 		b_col_info_needed = true;
+		rows_fetched = cur_row = 0;
+		return true;
+	}
+
+	// Execute for several parameter sets
+	statement::batch_result statement::execute_batch(
+			std::vector<param_array> & _params,
+			std::vector<SQLUSMALLINT> & _status, _tstring & _error)
+	{
+		RETCODE rc;
+		if (!is_open() || _params.empty())
+			return batch_unsupported;
+		SQLULEN rows = _params[0].ind.size(), processed = 0;
+		_status.assign(rows, SQL_PARAM_UNUSED);
+		if (!rows)
+			return batch_ok;
+
+		// The single parameters get bound again on the next use
+		SQLFreeStmt(stmt_h, SQL_RESET_PARAMS);
+		free_params();
+
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_BIND_TYPE,
+				(SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0);
+		if (TIODBC_SUCCESS_CODE(rc))
+			rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMSET_SIZE,
+					(SQLPOINTER)rows, 0);
+		// SQL_SUCCESS_WITH_INFO means the driver has changed the size
+		if (rc != SQL_SUCCESS) {
+			SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, 0);
+			return batch_unsupported;
+		}
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_STATUS_PTR, &_status[0], 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMS_PROCESSED_PTR, &processed, 0);
+
+		batch_result result = batch_ok;
+		for (size_t i = 0; i < _params.size(); ++i) {
+			param_array &p = _params[i];
+			p.fill_strings();
+			SQLSMALLINT sql_type = SQL_CHAR;
+			int col_size = 0;
+			switch (p.c_type) {
+			case SQL_C_SBIGINT:
+				sql_type = SQL_BIGINT;
+				break;
+			case SQL_C_DOUBLE:
+				sql_type = SQL_DOUBLE;
+				break;
+			case SQL_C_TYPE_TIMESTAMP:
+				sql_type = SQL_TYPE_TIMESTAMP;
+				col_size = 23;
+				break;
+			default:
+				col_size = p.elem_size / sizeof(SQLTCHAR) - 1;
+				if (col_size < 1)
+					col_size = 1;
+			}
+			try {
+				__bind_param(stmt_h, (int)(i + 1), p.c_type, sql_type,
+						&p.data[0], p.ind[0], col_size, p.elem_size);
+			}
+			catch (const bind_error &) {
+				_error = last_error_ex();
+				result = batch_failed;
+				break;
+			}
+		}
+		if (result == batch_ok) {
+			rc = SQLExecute(stmt_h);
+			if (!TIODBC_SUCCESS_CODE(rc) && rc != SQL_NO_DATA)
+				result = batch_failed;
+			// A partial failure comes as SQL_SUCCESS_WITH_INFO,
+			// the failed parameter sets are marked in the status array
+			for (SQLULEN i = 0; result == batch_ok && i < rows; ++i)
+				if (_status[i] == SQL_PARAM_ERROR ||
+						_status[i] == SQL_PARAM_DIAG_UNAVAILABLE)
+					result = batch_failed;
+			if (result == batch_failed)
+				_error = last_error_ex();
+		}
+
+		// Back to a single parameter set
+		SQLFreeStmt(stmt_h, SQL_RESET_PARAMS);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAM_STATUS_PTR, NULL, 0);
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_PARAMS_PROCESSED_PTR, NULL, 0);
+		return result;
+	}
+
+	// Execute sending a binary parameter in chunks
+	bool statement::execute_put_binary(std::istream & _in, SQLLEN _size,
+			size_t _chunk, _tstring & _error)
+	{
+		RETCODE rc;
+		if (!is_open())
+			return false;
+
+		rc = SQLExecute(stmt_h);
+		if (rc == SQL_NEED_DATA) {
+			std::vector<char> buf(_chunk > 0? _chunk: 1);
+			SQLPOINTER token;
+			rc = SQLParamData(stmt_h, &token);
+			while (rc == SQL_NEED_DATA) {
+				SQLLEN left = _size;
+				do {
+					SQLLEN n = left < (SQLLEN)buf.size()? left: (SQLLEN)buf.size();
+					if (n > 0) {
+						_in.read(&buf[0], n);
+						if (_in.gcount() != n) {
+							SQLCancel(stmt_h);
+							return false;
+						}
+					}
+					rc = SQLPutData(stmt_h, &buf[0], n);
+					if (!TIODBC_SUCCESS_CODE(rc)) {
+						// leave the need-data state, the statement
+						// may get executed again
+						_error = last_error_ex();
+						SQLCancel(stmt_h);
+						return false;
+					}
+					left -= n;
+				} while (left > 0);
+				rc = SQLParamData(stmt_h, &token);
+			}
+		}
+		if (!TIODBC_SUCCESS_CODE(rc) && rc != SQL_NO_DATA) {
+			_error = last_error_ex();
+			return false;
+		}
+		b_col_info_needed = true;
+		rows_fetched = cur_row = 0;
+		return true;
+	}
+
+	// Read a binary field in chunks
+	bool statement::get_binary(int _num, std::ostream & _out, size_t _chunk,
+			bool & _is_null)
+	{
+		RETCODE rc;
+		_is_null = false;
+		if (!is_open())
+			return false;
+
+		std::vector<char> buf(_chunk > 0? _chunk: 1);
+		while (true) {
+			SQLLEN len = 0;
+			rc = SQLGetData(stmt_h, _num, SQL_C_BINARY,
+					&buf[0], buf.size(), &len);
+			if (rc == SQL_NO_DATA)
+				break;
+			if (!TIODBC_SUCCESS_CODE(rc))
+				return false;
+			if (len == SQL_NULL_DATA) {
+				_is_null = true;
+				break;
+			}
+			// A truncated chunk fills the buffer, the length
+			// tells the bytes left or SQL_NO_TOTAL
+			size_t n = (len == SQL_NO_TOTAL || len > (SQLLEN)buf.size())?
+				buf.size(): (size_t)len;
+			_out.write(&buf[0], n);
+			if (rc == SQL_SUCCESS)
+				break;
+		}
 		return true;
 	}
 
@@ -821,6 +1159,107 @@ namespace tiodbc
 		return true;
 	}
 
+	//! @cond INTERNAL_FUNCTIONS
+
+	// Choose the C type and the buffer size to bind a column with,
+	// a LOB or a column of unknown size can't be bound
+	bool __block_type(SQLSMALLINT _sqltype, SQLULEN _col_size,
+						SQLSMALLINT & _ctype, SQLLEN & _elem_size)
+	{
+		switch (_sqltype) {
+		case SQL_INTEGER:
+		case SQL_SMALLINT:
+		case SQL_TINYINT:
+		case SQL_BIGINT:
+			_ctype = SQL_C_SBIGINT;
+			_elem_size = sizeof(SQLBIGINT);
+			return true;
+		case SQL_REAL:
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			_ctype = SQL_C_DOUBLE;
+			_elem_size = sizeof(SQLDOUBLE);
+			return true;
+		case SQL_DATE:
+		case SQL_TIMESTAMP:
+		case SQL_TYPE_DATE:
+		case SQL_TYPE_TIME:
+		case SQL_TYPE_TIMESTAMP:
+			_ctype = SQL_C_TIMESTAMP;
+			_elem_size = sizeof(TIMESTAMP_STRUCT);
+			return true;
+		case SQL_DECIMAL:
+		case SQL_NUMERIC:
+		case SQL_CHAR:
+		case SQL_VARCHAR:
+		case SQL_WCHAR:
+		case SQL_WVARCHAR: {
+			// Room for the sign, the point and the multibyte encodings
+			const SQLULEN max_bytes = 8000,
+				  char_bytes = sizeof(SQLTCHAR) == 1? 4: 2;
+			if (_col_size == 0 || (_col_size + 3) * char_bytes >= max_bytes)
+				return false;
+			_ctype = SQL_C_TCHAR;
+			_elem_size = ((_col_size + 3) * char_bytes + 1) * sizeof(SQLTCHAR);
+			return true;
+		}
+		}
+		return false;
+	}
+
+	//! @endcond
+
+	// Bind the columns to arrays, if the result set allows
+	bool statement::bind_block()
+	{
+		if (block_size <= 1 || m_cols.empty())
+			return false;
+		std::vector<bound_col> bound(m_cols.size());
+		for (size_t i = 0; i < m_cols.size(); ++i)
+			if (!__block_type(m_cols[i].type, m_cols[i].col_size,
+						bound[i].c_type, bound[i].elem_size))
+				return false;
+		RETCODE rc;
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_BIND_TYPE,
+				(SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+		rc = SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE,
+				(SQLPOINTER)block_size, 0);
+		if (!TIODBC_SUCCESS_CODE(rc))
+			return false;
+		// The driver may have chosen a smaller size
+		SQLULEN actual_size = block_size;
+		SQLGetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, &actual_size, 0, NULL);
+		if (actual_size < 1 || actual_size > block_size)
+			actual_size = block_size;
+		SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, &rows_fetched, 0);
+		m_bound.swap(bound);
+		for (size_t i = 0; i < m_bound.size(); ++i) {
+			bound_col &col = m_bound[i];
+			col.data.resize(actual_size * col.elem_size);
+			col.ind.resize(actual_size);
+			rc = SQLBindCol(stmt_h, (SQLUSMALLINT)(i + 1), col.c_type,
+					&col.data[0], col.elem_size, &col.ind[0]);
+			if (!TIODBC_SUCCESS_CODE(rc)) {
+				// Back to the row by row mode
+				SQLFreeStmt(stmt_h, SQL_UNBIND);
+				SQLSetStmtAttr(stmt_h, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)1, 0);
+				SQLSetStmtAttr(stmt_h, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0);
+				m_bound.clear();
+				return false;
+			}
+		}
+		b_block = true;
+		return true;
+	}
+
+	// Set the number of rows to fetch at once
+	void statement::set_block_size(int _rows)
+	{
+		block_size = _rows > 1? (SQLULEN)_rows: 1;
+	}
+
 	// Fetch next
 	bool statement::fetch_next()
 	{
@@ -831,6 +1270,17 @@ namespace tiodbc
 		if (b_col_info_needed) {
 			b_col_info_needed = false;
 			describe_cols();
+			// The bindings survive executing the statement again
+			if (!b_block)
+				bind_block();
+		}
+
+		if (b_block) {
+			if (++cur_row < rows_fetched)
+				return true;
+			rows_fetched = cur_row = 0;
+			rc = SQLFetch(stmt_h);
+			return TIODBC_SUCCESS_CODE(rc) && rows_fetched > 0;
 		}
 
 		rc = SQLFetch(stmt_h);
@@ -840,10 +1290,23 @@ namespace tiodbc
 	}
 
 	// Get a field by column number (1-based)
-	const field_impl statement::field(int _num) const
+	const field_impl statement::field(int _num, bool _need_name) const
 	{
-		_tstring name = sqltchar2ybstring(m_cols[_num - 1].name, "");
-		return field_impl(stmt_h, _num, name, m_cols[_num - 1].type);
+		_tstring name;
+		if (_need_name)
+			name = sqltchar2ybstring(m_cols[_num - 1].name, "");
+		field_impl f(stmt_h, _num, name, m_cols[_num - 1].type);
+		if (b_block) {
+			const bound_col &col = m_bound[_num - 1];
+			SQLLEN len = col.ind[cur_row];
+			f.bound_ptr = &col.data[cur_row * col.elem_size];
+			f.bound_ctype = col.c_type;
+			f.is_null_flag = len == SQL_NULL_DATA? 1: 0;
+			if (!f.is_null_flag && col.c_type == SQL_C_TCHAR &&
+					(len == SQL_NO_TOTAL || len >= col.elem_size))
+				throw fetch_error(_num);
+		}
+		return f;
 	}
 
 	// Count columns of the result
@@ -106,6 +106,16 @@ xmlize_row(const Row &row, const String &entry_name)
     return entry;
 }
 
+YBORM_DECL ElementTree::ElementPtr
+xmlize_row(const Values &row, const RowHeader &header, const String &entry_name)
+{
+    ElementTree::ElementPtr entry = ElementTree::new_element(entry_name);
+    for (size_t i = 0; i < row.size(); ++i)
+        entry->sub_element(mk_xml_name(header.name(i), _T("")),
+                row[i].nvl(Value(String(_T("")))).as_string());
+    return entry;
+}
+
 YBORM_DECL ElementTree::ElementPtr
 xmlize_rows(const Rows &rows, const String &entries_name, const String &entry_name)
 {
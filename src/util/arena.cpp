@@ -0,0 +1,100 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#define YBUTIL_SOURCE
+
+#include <new>
+#include "util/arena.h"
+
+namespace Yb {
+
+// Chunk sizes are rounded up to keep any object aligned
+#define YB_ARENA_ALIGN 16
+
+static inline size_t align_size(size_t size)
+{
+    return (size + YB_ARENA_ALIGN - 1) & ~(size_t)(YB_ARENA_ALIGN - 1);
+}
+
+Arena::Arena(size_t block_size)
+    : block_size_(align_size(block_size))
+    , block_pos_(block_size_)
+    , alloc_count_(0)
+    , reuse_count_(0)
+{}
+
+Arena::~Arena()
+{
+    std::vector<char *>::iterator i = blocks_.begin(), iend = blocks_.end();
+    for (; i != iend; ++i)
+        ::operator delete(*i);
+}
+
+void *Arena::allocate(size_t size)
+{
+    ++alloc_count_;
+    size = align_size(size);
+    size_t slot = size / YB_ARENA_ALIGN;
+    if (slot < free_lists_.size() && free_lists_[slot]) {
+        // The first word of a free chunk points to the next one
+        void *p = free_lists_[slot];
+        free_lists_[slot] = *(void **)p;
+        ++reuse_count_;
+        return p;
+    }
+    if (size > block_size_ / 4) {
+        // A big chunk gets its own block, the current one stays last
+        char *big = (char *)::operator new(size);
+        blocks_.insert(blocks_.end() - (blocks_.empty()? 0: 1), big);
+        return big;
+    }
+    if (block_pos_ + size > block_size_) {
+        blocks_.push_back((char *)::operator new(block_size_));
+        block_pos_ = 0;
+    }
+    void *p = blocks_.back() + block_pos_;
+    block_pos_ += size;
+    return p;
+}
+
+void Arena::deallocate(void *p, size_t size)
+{
+    size_t slot = align_size(size) / YB_ARENA_ALIGN;
+    if (slot >= free_lists_.size())
+        free_lists_.resize(slot + 1);
+    *(void **)p = free_lists_[slot];
+    free_lists_[slot] = p;
+}
+
+// Each chunk is prefixed with the pointer to its arena
+#define YB_ARENA_HEADER YB_ARENA_ALIGN
+
+YBUTIL_DECL void *arena_new(size_t size, Arena *arena)
+{
+    char *p;
+    if (arena) {
+        p = (char *)arena->allocate(size + YB_ARENA_HEADER);
+        arena->add_ref();
+    }
+    else
+        p = (char *)::operator new(size + YB_ARENA_HEADER);
+    *(Arena **)p = arena;
+    return p + YB_ARENA_HEADER;
+}
+
+YBUTIL_DECL void arena_delete(void *p, size_t size)
+{
+    if (!p)
+        return;
+    char *q = (char *)p - YB_ARENA_HEADER;
+    Arena *arena = *(Arena **)q;
+    if (arena) {
+        if (size)
+            arena->deallocate(q, size + YB_ARENA_HEADER);
+        arena->release();
+    }
+    else
+        ::operator delete(q);
+}
+
+} // namespace Yb
+
+// vim:ts=4:sts=4:sw=4:et:
@@ -3,13 +3,27 @@
 
 #include <time.h>
 #include <stdio.h>
+#include <new>
 #include <iomanip>
 #include "util/string_utils.h"
 #include "util/value_type.h"
+#if defined(YBUTIL_WINDOWS)
+#include <windows.h>
+#endif
 
 using namespace std;
 using namespace Yb::StrUtils;
 
+// The buffers may be shared by the Values of different threads,
+// like the default values of the columns
+#if defined(YBUTIL_WINDOWS)
+#define YB_ATOMIC_INC(x) InterlockedIncrement(&(x))
+#define YB_ATOMIC_DEC(x) InterlockedDecrement(&(x))
+#else
+#define YB_ATOMIC_INC(x) __sync_add_and_fetch(&(x), 1)
+#define YB_ATOMIC_DEC(x) __sync_sub_and_fetch(&(x), 1)
+#endif
+
 namespace Yb {
 
 template <class T__>
@@ -22,169 +36,190 @@ static inline const T__ &get_as(const void *data) {
     return *reinterpret_cast<const T__ *>(data);
 }
 
+template <class T__>
+static inline void destruct(void *data) {
+    reinterpret_cast<T__ *>(data)->~T__();
+}
+
+//! Reference counted buffer of a string or a blob
+struct SharedBufBase {
+    volatile long refs_;
+    SharedBufBase(): refs_(1) {}
+};
+
+template <class T__>
+struct SharedBuf: public SharedBufBase {
+    const T__ data_;
+    explicit SharedBuf(const T__ &x): data_(x) {}
+};
+
+template <class T__>
+static inline void *new_shared(const T__ &x) {
+    return static_cast<SharedBufBase *>(new SharedBuf<T__>(x));
+}
+
+template <class T__>
+static inline const T__ &shared_data(const void *p) {
+    return static_cast<const SharedBuf<T__> *>(
+            static_cast<const SharedBufBase *>(p))->data_;
+}
+
+static inline void add_ref(void *p) {
+    YB_ATOMIC_INC(static_cast<SharedBufBase *>(p)->refs_);
+}
+
+template <class T__>
+static inline void release(void *p) {
+    SharedBufBase *b = static_cast<SharedBufBase *>(p);
+    if (!YB_ATOMIC_DEC(b->refs_))
+        delete static_cast<SharedBuf<T__> *>(b);
+}
+
 const int &
 Value::read_as_integer() const { return get_as<int>(&data_); }
 
 const LongInt &
-Value::read_as_longint() const { return get_as<LongInt>(&data_); }
+Value::read_as_longint() const { return data_.i_; }
 
 const String &
-Value::read_as_string() const { return *get_as<const String *>(&data_); }
+Value::read_as_string() const { return shared_data<String>(data_.p_); }
 
 const Decimal &
-Value::read_as_decimal() const { return *get_as<const Decimal *>(&data_); }
+Value::read_as_decimal() const { return get_as<Decimal>(data_.buf_); }
 
 const DateTime &
-Value::read_as_datetime() const { return *get_as<const DateTime *>(&data_); }
+Value::read_as_datetime() const { return get_as<DateTime>(data_.buf_); }
 
 const double &
-Value::read_as_float() const { return get_as<double>(&data_); }
+Value::read_as_float() const { return data_.f_; }
 
 const Blob &
-Value::read_as_blob() const { return *get_as<const Blob *>(&data_); }
+Value::read_as_blob() const { return shared_data<Blob>(data_.p_); }
 
 ValueIsNull::ValueIsNull()
     : ValueError(_T("Trying to get value of null"))
 {}
 
-void
-Value::init()
-{
-    switch (type_) {
-    case STRING:
-        get_as<String *>(&data_) = new String();
-        break;
-    case DECIMAL:
-        get_as<Decimal *>(&data_) = new Decimal();
-        break;
-    case DATETIME:
-        get_as<DateTime *>(&data_) = new DateTime();
-        break;
-    case BLOB:
-        get_as<Blob *>(&data_) = new Blob();
-        break;
-    }
-}
-
 void
 Value::destroy()
 {
     switch (type_) {
     case STRING:
-        delete get_as<String *>(&data_);
+        release<String>(data_.p_);
         break;
     case DECIMAL:
-        delete get_as<Decimal *>(&data_);
+        destruct<Decimal>(data_.buf_);
         break;
     case DATETIME:
-        delete get_as<DateTime *>(&data_);
+        destruct<DateTime>(data_.buf_);
         break;
     case BLOB:
-        delete get_as<Blob *>(&data_);
+        release<Blob>(data_.p_);
         break;
     default:
         return;
     }
-    get_as<void *>(&data_) = NULL;
+    data_.i_ = 0;
 }
 
 void
 Value::assign(const Value &other)
 {
-    if (type_ != other.type_) {
+    switch (other.type_) {
+    case STRING:
+    case BLOB:
+        // the buffer is shared, not copied
+        add_ref(other.data_.p_);
         destroy();
         type_ = other.type_;
-        init();
-    }
-    switch (type_) {
-    case INTEGER:
-        get_as<int>(&data_) = other.read_as_integer();
-        break;
-    case LONGINT:
-        get_as<LongInt>(&data_) = other.read_as_longint();
-        break;
-    case STRING:
-        *get_as<String *>(&data_) = other.read_as_string();
+        data_.p_ = other.data_.p_;
         break;
     case DECIMAL:
-        *get_as<Decimal *>(&data_) = other.read_as_decimal();
+        if (type_ == DECIMAL) {
+            get_as<Decimal>(data_.buf_) = other.read_as_decimal();
+            break;
+        }
+        destroy();
+        type_ = DECIMAL;
+        new (data_.buf_) Decimal(other.read_as_decimal());
         break;
     case DATETIME:
-        *get_as<DateTime *>(&data_) = other.read_as_datetime();
-        break;
-    case FLOAT:
-        get_as<double>(&data_) = other.read_as_float();
-        break;
-    case BLOB:
-        *get_as<Blob *>(&data_) = other.read_as_blob();
+        if (type_ == DATETIME) {
+            get_as<DateTime>(data_.buf_) = other.read_as_datetime();
+            break;
+        }
+        destroy();
+        type_ = DATETIME;
+        new (data_.buf_) DateTime(other.read_as_datetime());
         break;
+    default:
+        destroy();
+        type_ = other.type_;
+        data_.i_ = other.data_.i_;
     }
 }
 
 Value::Value()
     : type_(INVALID)
-    , data_(0)
-{}
+{
+    data_.i_ = 0;
+}
 
 Value::Value(const int &x)
     : type_(INTEGER)
-    , data_(0)
 {
+    data_.i_ = 0;
     get_as<int>(&data_) = x;
 }
 
 Value::Value(const LongInt &x)
     : type_(LONGINT)
-    , data_(x)
-{}
+{
+    data_.i_ = x;
+}
 
 Value::Value(const double &x)
     : type_(FLOAT)
-    , data_(0)
 {
-    get_as<double>(&data_) = x;
+    data_.f_ = x;
 }
 
 Value::Value(const Decimal &x)
     : type_(DECIMAL)
-    , data_(0)
 {
-    get_as<Decimal *>(&data_) = new Decimal(x);
+    new (data_.buf_) Decimal(x);
 }
 
 Value::Value(const DateTime &x)
     : type_(DATETIME)
-    , data_(0)
 {
-    get_as<DateTime *>(&data_) = new DateTime(x);
+    new (data_.buf_) DateTime(x);
 }
 
 Value::Value(const String &x)
     : type_(STRING)
-    , data_(0)
 {
-    get_as<String *>(&data_) = new String(x);
+    data_.p_ = new_shared(x);
 }
 
 Value::Value(const Char *x)
     : type_(x != NULL? STRING: INVALID)
-    , data_(0)
 {
+    data_.i_ = 0;
     if (type_ == STRING)
-        get_as<String *>(&data_) = new String(str_from_chars(x));
+        data_.p_ = new_shared(str_from_chars(x));
 }
 
 Value::Value(const Blob &x)
     : type_(BLOB)
-    , data_(0)
 {
-    get_as<Blob *>(&data_) = new Blob(x);
+    data_.p_ = new_shared(x);
 }
 
 Value::Value(const Value &other)
     : type_(INVALID)
-    , data_(0)
 {
+    data_.i_ = 0;
     assign(other);
 }
 
@@ -196,17 +231,33 @@ Value::operator=(const Value &other)
     return *this;
 }
 
-Value::~Value()
+// Decimal and DateTime of every flavour may be moved bitwise
+#if defined(YB_USE_RVALUE_REFS)
+Value::Value(Value &&other)
+    : type_(other.type_)
+    , data_(other.data_)
 {
-    destroy();
+    other.type_ = INVALID;
+    other.data_.i_ = 0;
+}
+
+Value &
+Value::operator=(Value &&other)
+{
+    if (this != &other) {
+        destroy();
+        type_ = other.type_;
+        data_ = other.data_;
+        other.type_ = INVALID;
+        other.data_.i_ = 0;
+    }
+    return *this;
 }
+#endif // defined(YB_USE_RVALUE_REFS)
 
-template <class Int__>
-static inline void xor_swap(Int__ &a, Int__ &b)
+Value::~Value()
 {
-    a ^= b;
-    b ^= a;
-    a ^= b;
+    destroy();
 }
 
 void
@@ -214,8 +265,10 @@ Value::swap(Value &other)
 {
     if (this == &other)
         return;
-    xor_swap(type_, other.type_);
-    xor_swap(data_, other.data_);
+    std::swap(type_, other.type_);
+    Data t = data_;
+    data_ = other.data_;
+    other.data_ = t;
 }
 
 void
@@ -243,7 +296,7 @@ Value::fix_type(int type)
             LongInt t = as_longint();
             destroy();
             type_ = type;
-            get_as<LongInt>(&data_) = t;
+            data_.i_ = t;
         }
         break;
     case Value::STRING:
@@ -251,8 +304,7 @@ Value::fix_type(int type)
             String t = as_string();
             destroy();
             type_ = type;
-            init();
-            *get_as<String *>(&data_) = t;
+            data_.p_ = new_shared(t);
         }
         break;
     case Value::DECIMAL:
@@ -260,8 +312,7 @@ Value::fix_type(int type)
             Decimal t = as_decimal();
             destroy();
             type_ = type;
-            init();
-            *get_as<Decimal *>(&data_) = t;
+            new (data_.buf_) Decimal(t);
         }
         break;
     case Value::DATETIME:
@@ -269,8 +320,7 @@ Value::fix_type(int type)
             DateTime t = as_date_time();
             destroy();
             type_ = type;
-            init();
-            *get_as<DateTime *>(&data_) = t;
+            new (data_.buf_) DateTime(t);
         }
         break;
     case Value::FLOAT:
@@ -278,7 +328,7 @@ Value::fix_type(int type)
             double t = as_float();
             destroy();
             type_ = type;
-            get_as<double>(&data_) = t;
+            data_.f_ = t;
         }
         break;
     case Value::BLOB:
@@ -286,8 +336,7 @@ Value::fix_type(int type)
             Blob t = as_blob();
             destroy();
             type_ = type;
-            init();
-            *get_as<Blob *>(&data_) = t;
+            data_.p_ = new_shared(t);
         }
         break;
     }
@@ -536,18 +585,22 @@ key_cmp(const Key &x, const Key &y)
     r = (int)!!x.table - (int)!!y.table;
     if (r || !x.table)
         return r;
-    r = CharBuf<Char>::x_strcmp(str_data(*x.table),
-                                str_data(*y.table));
-    if (r)
-        return r;
+    if (x.table != y.table) {
+        r = CharBuf<Char>::x_strcmp(str_data(*x.table),
+                                    str_data(*y.table));
+        if (r)
+            return r;
+    }
     r = (int)!!x.id_name - (int)!!y.id_name;
     if (r)
         return r;
     if (x.id_name) {
-        r = CharBuf<Char>::x_strcmp(str_data(*x.id_name),
-                                    str_data(*y.id_name));
-        if (r)
-            return r;
+        if (x.id_name != y.id_name) {
+            r = CharBuf<Char>::x_strcmp(str_data(*x.id_name),
+                                        str_data(*y.id_name));
+            if (r)
+                return r;
+        }
         r = (int)!x.id_is_null - (int)!y.id_is_null;
         if (r || x.id_is_null)
             return r;
@@ -571,6 +624,64 @@ key_cmp(const Key &x, const Key &y)
     return 0;
 }
 
+static inline size_t hash_combine(size_t h, size_t x)
+{
+    return h ^ (x + 0x9e3779b9 + (h << 6) + (h >> 2));
+}
+
+static size_t str_hash(const String &s)
+{
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (const Char *p = str_data(s); char_code(*p); ++p) {
+        h ^= (size_t)char_code(*p);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t long_hash(LongInt x)
+{
+    return hash_combine((size_t)(x & 0xFFFFFFFF), (size_t)(x >> 32));
+}
+
+YBUTIL_DECL size_t
+key_hash(const Key &key)
+{
+    if (key.hash_value)
+        return key.hash_value;
+    size_t h = 0;
+    if (key.table) {
+        h = str_hash(*key.table);
+        if (key.id_name) {
+            if (!key.id_is_null)
+                h = hash_combine(h, long_hash(key.id_value));
+        }
+        else {
+            ValueMap::const_iterator i = key.fields.begin(),
+                                     iend = key.fields.end();
+            for (; i != iend; ++i) {
+                // Value::cmp() compares the values of different types
+                // as strings, and decimals numerically
+                switch (i->second.get_type()) {
+                case Value::INVALID:
+                case Value::DECIMAL:
+                case Value::FLOAT:
+                    h = hash_combine(h, 0);
+                    break;
+                case Value::STRING:
+                    h = hash_combine(h, str_hash(i->second.read_as_string()));
+                    break;
+                default:
+                    h = hash_combine(h, str_hash(i->second.as_string()));
+                }
+            }
+        }
+    }
+    key.hash_value = h? h: 1;
+    return key.hash_value;
+}
+
 YBUTIL_DECL bool
 empty_key(const Key &key)
 {
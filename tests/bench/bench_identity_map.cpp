@@ -0,0 +1,76 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <time.h>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+#include <iostream>
+#include "orm/data_object.h"
+
+using namespace std;
+using namespace Yb;
+
+static double elapsed(clock_t t0)
+{
+    return (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+static void report(const char *what, double sec, int n)
+{
+    cout << what << ": " << sec << " s, "
+        << sec * 1e9 / n << " ns/op" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 1000000;
+    Schema schema;
+    Table::Ptr t(new Table(_T("T"), _T(""), _T("T")));
+    t->add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+    t->add_column(Column(_T("A"), Value::STRING, 20));
+    schema.add_table(t);
+    schema.fill_fkeys();
+    const Table &table = schema.table(_T("T"));
+    DataObjectList objs;
+    objs.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        DataObject::Ptr d = DataObject::create_new(table);
+        d->set(_T("ID"), i);
+        d->key();
+        objs.push_back(d);
+    }
+    // The keys are looked up in a scattered order
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i)
+        order[i] = (int)((LongInt)i * 1000003 % n);
+    cout << "objects: " << n << endl;
+
+    typedef std::map<Key, DataObject *> KeyMap;
+    KeyMap key_map;
+    clock_t t0 = clock();
+    for (int i = 0; i < n; ++i)
+        key_map[objs[i]->key()] = shptr_get(objs[i]);
+    report("std::map insert", elapsed(t0), n);
+    IdentityMap idmap;
+    t0 = clock();
+    for (int i = 0; i < n; ++i)
+        idmap.insert(shptr_get(objs[i]));
+    report("IdentityMap insert", elapsed(t0), n);
+
+    // Each lookup is done with a new key, as in Session::get_lazy()
+    long found = 0;
+    t0 = clock();
+    for (int i = 0; i < n; ++i)
+        found += key_map.find(table.mk_key(order[i])) != key_map.end();
+    report("std::map find", elapsed(t0), n);
+    t0 = clock();
+    for (int i = 0; i < n; ++i)
+        found += idmap.find(table.mk_key(order[i])) != NULL;
+    report("IdentityMap find", elapsed(t0), n);
+    if (found != 2L * n) {
+        cerr << "lookup failed" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
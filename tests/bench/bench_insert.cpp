@@ -0,0 +1,97 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <stdlib.h>
+#include <vector>
+#include <iostream>
+#include "util/nlogger.h"
+#include "orm/data_object.h"
+
+using namespace std;
+using namespace Yb;
+
+// Run with YBORM_URL pointing to a scratch database,
+// table T_BENCH_INSERT is created and dropped there.
+
+static void report(const char *what, MilliSec ms, int n)
+{
+    cout << what << ": " << ms << " ms, "
+        << (ms? (LongInt)n * 1000 / ms: 0) << " rows/s" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 10000;
+    Schema schema;
+    Table::Ptr t(new Table(_T("T_BENCH_INSERT"), _T(""), _T("BenchInsert")));
+    t->add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+    t->add_column(Column(_T("A"), Value::STRING, 40));
+    t->add_column(Column(_T("B"), Value::DECIMAL, 0));
+    schema.add_table(t);
+    schema.fill_fkeys();
+    const Table &table = schema.table(_T("T_BENCH_INSERT"));
+    Engine engine;
+    engine.drop_schema(schema, true);
+    engine.create_schema(schema);
+    engine.commit();
+    cout << "rows: " << n << endl;
+
+    // The old way: one statement executed per row
+    SqlConnection *conn = engine.get_conn();
+    MilliSec t0 = get_cur_time_millisec();
+    conn->begin_trans_if_necessary();
+    conn->prepare(_T("INSERT INTO T_BENCH_INSERT (ID, A, B) VALUES (?, ?, ?)"));
+    Values params(3);
+    for (int i = 0; i < n; ++i) {
+        params[0] = Value((LongInt)i);
+        params[1] = Value(_T("row"));
+        params[2] = Value(Decimal(i));
+        conn->exec(params);
+    }
+    engine.commit();
+    report("row by row", get_cur_time_millisec() - t0, n);
+    engine.exec_proc(_T("DELETE FROM T_BENCH_INSERT"));
+    engine.commit();
+
+    // Several rows per statement, as the dialect allows
+    vector<Values> data(n, Values(3));
+    RowsData rows(n);
+    for (int i = 0; i < n; ++i) {
+        data[i][0] = Value((LongInt)i);
+        data[i][1] = Value(_T("row"));
+        data[i][2] = Value(Decimal(i));
+        rows[i] = &data[i];
+    }
+    t0 = get_cur_time_millisec();
+    engine.insert(table, rows, false);
+    engine.commit();
+    report("EngineBase::insert", get_cur_time_millisec() - t0, n);
+    engine.exec_proc(_T("DELETE FROM T_BENCH_INSERT"));
+    engine.commit();
+
+    {
+        Session session(schema, &engine);
+        DataObjectList objs;
+        objs.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            DataObject::Ptr d = DataObject::create_new(table);
+            d->set(_T("ID"), Value((LongInt)i));
+            d->set(_T("A"), Value(_T("row")));
+            d->set(_T("B"), Value(Decimal(i)));
+            session.save(d);
+            objs.push_back(d);
+        }
+        t0 = get_cur_time_millisec();
+        session.commit();
+        report("Session::flush", get_cur_time_millisec() - t0, n);
+    }
+    Value count = engine.select1(Expression(_T("COUNT(*)")),
+            ColumnExpr(table.name()), Expression());
+    engine.drop_schema(schema, true);
+    engine.commit();
+    if (count.as_longint() != n) {
+        cerr << "inserted " << count.as_longint() << " rows" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
@@ -0,0 +1,104 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include "orm/data_object.h"
+
+using namespace std;
+using namespace Yb;
+
+// Count the heap memory in use, the block size is kept in front of it
+static size_t heap_bytes = 0, heap_blocks = 0;
+
+void *operator new(size_t size)
+{
+    size_t *p = (size_t *)malloc(size + sizeof(size_t) * 2);
+    if (!p)
+        throw std::bad_alloc();
+    *p = size;
+    heap_bytes += size;
+    ++heap_blocks;
+    return p + 2;
+}
+
+void operator delete(void *q) throw()
+{
+    if (!q)
+        return;
+    size_t *p = (size_t *)q - 2;
+    heap_bytes -= *p;
+    --heap_blocks;
+    free(p);
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *q) throw() { operator delete(q); }
+
+static void init_schema(Schema &schema)
+{
+    Table::Ptr t(new Table(_T("A"), _T(""), _T("A")));
+    t->add_column(Column(_T("X"), Value::LONGINT, 0, Column::PK));
+    t->add_column(Column(_T("Y"), Value::STRING, 4));
+    t->add_column(Column(_T("P"), Value::LONGINT, 0, 0,
+                Value(), _T("A"), _T("X")));
+    t->add_column(Column(_T("R"), Value::LONGINT, 0, Column::RO));
+    schema.add_table(t);
+    Table::Ptr u(new Table(_T("B"), _T(""), _T("B")));
+    u->add_column(Column(_T("Z"), Value::LONGINT, 0, Column::PK));
+    u->add_column(Column(_T("X"), Value::LONGINT, 0, 0,
+                Value(), _T("A"), _T("X")));
+    u->add_column(Column(_T("Q"), Value::DECIMAL));
+    schema.add_table(u);
+    Relation::AttrMap attr_a, attr_b;
+    attr_a[_T("property")] = _T("SlaveBs");
+    attr_b[_T("property")] = _T("MasterA");
+    Relation::Ptr re(new Relation(Relation::ONE2MANY,
+                _T("A"), attr_a, _T("B"), attr_b));
+    schema.add_relation(re);
+    attr_a[_T("property")] = _T("ChildAs");
+    attr_b[_T("property")] = _T("ParA");
+    Relation::Ptr re2(new Relation(Relation::ONE2MANY,
+                _T("A"), attr_a, _T("A"), attr_b));
+    schema.add_relation(re2);
+    schema.fill_fkeys();
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 10000;
+    Schema schema;
+    init_schema(schema);
+    const Table &a = schema.table(_T("A")), &b = schema.table(_T("B"));
+    cout << "sizeof(DataObject): " << sizeof(DataObject) << endl;
+    cout << "sizeof(RelationObject): " << sizeof(RelationObject) << endl;
+    DataObjectList objs;
+    objs.reserve(n * 2);
+    size_t bytes0 = heap_bytes, blocks0 = heap_blocks;
+    // Each master A gets one slave B, the objects are filled
+    // from rows as if they were loaded
+    for (int i = 0; i < n; ++i) {
+        Row ra, rb;
+        ra.push_back(make_pair(String(_T("X")), Value((LongInt)i + 1)));
+        ra.push_back(make_pair(String(_T("Y")), Value(_T("abc"))));
+        ra.push_back(make_pair(String(_T("P")), Value()));
+        ra.push_back(make_pair(String(_T("R")), Value()));
+        rb.push_back(make_pair(String(_T("Z")), Value((LongInt)i + 1)));
+        rb.push_back(make_pair(String(_T("X")), Value((LongInt)i + 1)));
+        rb.push_back(make_pair(String(_T("Q")), Value(Decimal(_T("1.5")))));
+        DataObject::Ptr d = DataObject::create_new(a, DataObject::Ghost);
+        d->fill_from_row(ra);
+        DataObject::Ptr e = DataObject::create_new(b, DataObject::Ghost);
+        e->fill_from_row(rb);
+        DataObject::link_slave_to_master(e, d, _T("MasterA"));
+        objs.push_back(d);
+        objs.push_back(e);
+    }
+    cout << "objects: " << n * 2 << endl;
+    cout << "bytes per object: "
+        << (double)(heap_bytes - bytes0) / (n * 2) << endl;
+    cout << "heap blocks per object: "
+        << (double)(heap_blocks - blocks0) / (n * 2) << endl;
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
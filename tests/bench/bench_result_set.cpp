@@ -0,0 +1,82 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include "util/nlogger.h"
+#include "util/value_type.h"
+#include "util/result_set.h"
+
+using namespace std;
+using namespace Yb;
+
+// Count the heap blocks allocated
+static size_t heap_allocs = 0;
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size? size: 1);
+    if (!p)
+        throw std::bad_alloc();
+    ++heap_allocs;
+    return p;
+}
+
+void operator delete(void *p) throw() { free(p); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) throw() { operator delete(p); }
+
+typedef pair<String, Value> Item;
+typedef vector<Item> Row;
+
+// Produces the rows the way SqlResultSet does, from a row of values
+// swapped into the buffer given, so only the iteration path is measured
+class GenResultSet: public ResultSetBase<Row>
+{
+    int n_, i_;
+    Strings names_;
+    Values values_;
+
+    bool fetch(Row &row) {
+        if (i_ >= n_)
+            return false;
+        values_[0] = Value((LongInt)i_);
+        values_[1] = Value(i_ * 0.5);
+        values_[2] = Value(i_);
+        if (row.size() != names_.size())
+            row.resize(names_.size());
+        for (size_t j = 0; j < names_.size(); ++j) {
+            if (row[j].first != names_[j])
+                row[j].first = names_[j];
+            row[j].second.swap(values_[j]);
+        }
+        ++i_;
+        return true;
+    }
+public:
+    GenResultSet(int n): n_(n), i_(0), values_(3) {
+        names_.push_back(_T("ID"));
+        names_.push_back(_T("AMOUNT_WITH_A_LONG_COLUMN_NAME"));
+        names_.push_back(_T("QTY"));
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 1000000;
+    cout << "rows: " << n << endl;
+    GenResultSet rs(n);
+    LongInt sum = 0;
+    size_t a0 = heap_allocs;
+    MilliSec t0 = get_cur_time_millisec();
+    GenResultSet::iterator it = rs.begin(), end = rs.end();
+    for (; it != end; ++it)
+        sum += (*it)[2].second.read_as<int>();
+    MilliSec ms = get_cur_time_millisec() - t0;
+    cout << "iterate: " << ms << " ms, "
+        << (ms? (LongInt)n * 1000 / ms: 0) << " rows/s, "
+        << (double)(heap_allocs - a0) / n << " allocs/row" << endl;
+    cout << "checksum: " << sum << endl;
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
@@ -0,0 +1,98 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <stdlib.h>
+#include <vector>
+#include <iostream>
+#include "util/nlogger.h"
+#include "orm/data_object.h"
+
+using namespace std;
+using namespace Yb;
+
+// Run with YBORM_URL pointing to a scratch database,
+// table T_BENCH_SELECT is created and dropped there.
+
+static void report(const char *what, MilliSec ms, int n)
+{
+    cout << what << ": " << ms << " ms, "
+        << (ms? (LongInt)n * 1000 / ms: 0) << " rows/s" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 10000;
+    int passes = argc > 2? atoi(argv[2]): 5;
+    Schema schema;
+    Table::Ptr t(new Table(_T("T_BENCH_SELECT"), _T(""), _T("BenchSelect")));
+    t->add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+    t->add_column(Column(_T("I"), Value::INTEGER, 0));
+    t->add_column(Column(_T("A"), Value::STRING, 40));
+    t->add_column(Column(_T("B"), Value::DECIMAL, 0));
+    t->add_column(Column(_T("C"), Value::FLOAT, 0));
+    t->add_column(Column(_T("D"), Value::DATETIME, 0));
+    schema.add_table(t);
+    schema.fill_fkeys();
+    const Table &table = schema.table(_T("T_BENCH_SELECT"));
+    Engine engine;
+    engine.drop_schema(schema, true);
+    engine.create_schema(schema);
+    engine.commit();
+    cout << "rows: " << n << ", passes: " << passes << endl;
+
+    vector<Values> data(n, Values(6));
+    RowsData rows(n);
+    DateTime d0 = dt_make(2001, 1, 1);
+    for (int i = 0; i < n; ++i) {
+        data[i][0] = Value((LongInt)i + 5000000000LL);
+        data[i][1] = Value(i);
+        data[i][2] = Value(_T("row"));
+        data[i][3] = Value(Decimal(i) / Decimal(100));
+        data[i][4] = Value(i * 0.5);
+        data[i][5] = Value(d0);
+        rows[i] = &data[i];
+    }
+    MilliSec t0 = get_cur_time_millisec();
+    engine.insert(table, rows, false);
+    engine.commit();
+    report("EngineBase::insert", get_cur_time_millisec() - t0, n);
+
+    // Plain rows, the values typed as the table says
+    SqlConnection *conn = engine.get_conn();
+    LongInt sum = 0;
+    t0 = get_cur_time_millisec();
+    for (int p = 0; p < passes; ++p) {
+        conn->prepare(_T("SELECT ID, I, A, B, C, D FROM T_BENCH_SELECT"));
+        SqlResultSet rs = conn->exec(Values());
+        Values values;
+        while (rs.fetch_values(values)) {
+            for (size_t j = 0; j < values.size(); ++j)
+                values[j].fix_type(table[j].type());
+            sum += values[0].read_as_longint();
+        }
+    }
+    report("SqlResultSet::fetch_values", get_cur_time_millisec() - t0,
+           n * passes);
+
+    // Objects, as a query would load them
+    t0 = get_cur_time_millisec();
+    for (int p = 0; p < passes; ++p) {
+        Session session(schema, &engine);
+        session.set_stateless(true);
+        DataObjectResultSet rs = session.load_collection(
+                ColumnExpr(table.name()), Expression());
+        DataObjectResultSet::iterator i = rs.begin(), iend = rs.end();
+        for (; i != iend; ++i)
+            sum -= (*i)[0]->get(0).as_longint();
+    }
+    report("Session::load_collection", get_cur_time_millisec() - t0,
+           n * passes);
+
+    engine.drop_schema(schema, true);
+    engine.commit();
+    if (sum != 0) {
+        cerr << "checksum mismatch: " << sum << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
@@ -0,0 +1,84 @@
+// -*- Mode: C++; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <iostream>
+#include "util/nlogger.h"
+#include "util/value_type.h"
+
+using namespace std;
+using namespace Yb;
+
+// Count the heap blocks allocated
+static size_t heap_allocs = 0;
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size? size: 1);
+    if (!p)
+        throw std::bad_alloc();
+    ++heap_allocs;
+    return p;
+}
+
+void operator delete(void *p) throw() { free(p); }
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) throw() { operator delete(p); }
+
+static const int N_COLS = 7;
+
+static void report(const char *what, MilliSec ms, size_t allocs, int n)
+{
+    cout << what << ": " << ms << " ms, "
+        << (ms? (LongInt)n * 1000 / ms: 0) << " rows/s, "
+        << (double)allocs / n << " allocs/row" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1? atoi(argv[1]): 200000;
+    cout << "sizeof(Value): " << sizeof(Value) << endl;
+    cout << "rows: " << n << ", columns: " << N_COLS << endl;
+    String long_str(60, _T('x'));
+    DateTime d0 = dt_make(2001, 1, 1);
+    Decimal dec(_T("12.34"));
+    vector<Values> rows(n);
+
+    // Materialise the rows as a driver does, typed values one by one
+    size_t a0 = heap_allocs;
+    MilliSec t0 = get_cur_time_millisec();
+    for (int i = 0; i < n; ++i) {
+        Values &row = rows[i];
+        row.reserve(N_COLS);
+        row.push_back(Value((LongInt)i));
+        row.push_back(Value(_T("short")));
+        row.push_back(Value(long_str));
+        row.push_back(Value(dec));
+        row.push_back(Value(d0));
+        row.push_back(Value(i * 0.5));
+        row.push_back(Value());
+    }
+    report("build", get_cur_time_millisec() - t0, heap_allocs - a0, n);
+
+    // Copy them, as the rows get into the objects and the caches
+    vector<Values> copies(n);
+    a0 = heap_allocs;
+    t0 = get_cur_time_millisec();
+    for (int i = 0; i < n; ++i)
+        copies[i] = rows[i];
+    report("copy", get_cur_time_millisec() - t0, heap_allocs - a0, n);
+
+    // Read them back
+    LongInt sum = 0;
+    t0 = get_cur_time_millisec();
+    for (int i = 0; i < n; ++i) {
+        const Values &row = copies[i];
+        sum += row[0].as_longint() + row[1].read_as<String>().size()
+            + row[2].read_as<String>().size() + dt_day(row[4].read_as<DateTime>());
+    }
+    report("read", get_cur_time_millisec() - t0, 0, n);
+    cout << "checksum: " << sum << endl;
+    return 0;
+}
+
+// vim:ts=4:sts=4:sw=4:et:
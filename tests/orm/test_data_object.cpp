@@ -2,8 +2,10 @@
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/TestAssert.h>
 #include "util/string_utils.h"
+#include <sstream>
 #include "orm/data_object.h"
 #include "orm/domain_object.h"
+#include "orm/object_cache.h"
 #include "orm/schema_config.h"
 
 using namespace std;
@@ -22,6 +24,11 @@ class TestDataObject : public CppUnit::TestFixture
     //CPPUNIT_TEST_EXCEPTION(test_data_object_already_saved,
     //                       DataObjectAlreadyInSession);
     CPPUNIT_TEST(test_save_or_update);
+    CPPUNIT_TEST(test_dirty_columns);
+    CPPUNIT_TEST(test_work_lists);
+    CPPUNIT_TEST(test_identity_map);
+    CPPUNIT_TEST(test_session_arena);
+    CPPUNIT_TEST(test_relation_slots);
     CPPUNIT_TEST_EXCEPTION(test_data_object_cant_change_key_if_saved,
                            ReadOnlyColumn);
     CPPUNIT_TEST(test_data_object_link);
@@ -36,6 +43,7 @@ class TestDataObject : public CppUnit::TestFixture
     CPPUNIT_TEST(test_calc_depth);
     CPPUNIT_TEST_EXCEPTION(test_cycle_detected, CycleDetected);
     CPPUNIT_TEST(test_filter_by_key);
+    CPPUNIT_TEST(test_filter_by_keys);
     //CPPUNIT_TEST(test_bad_type_cast_format);
     CPPUNIT_TEST_SUITE_END();
 
@@ -132,6 +140,13 @@ public:
         CPPUNIT_ASSERT(d->assigned_key());
         k.reset(&tbl_a, &col_x, 10, false);
         CPPUNIT_ASSERT(k == d->key());
+        CPPUNIT_ASSERT(d->table().same_key(d->raw_values(), k));
+        CPPUNIT_ASSERT_EQUAL(key_hash(k), d->key_hash());
+        // the hash is kept until a primary key column changes
+        d->set(_T("X"), Value(11));
+        k.reset(&tbl_a, &col_x, 11, false);
+        CPPUNIT_ASSERT(d->table().same_key(d->raw_values(), k));
+        CPPUNIT_ASSERT_EQUAL(key_hash(k), d->key_hash());
     }
 
     void test_data_object_save_no_id()
@@ -194,6 +209,134 @@ public:
         CPPUNIT_ASSERT_EQUAL(string("xyz"), NARROW(f->get(_T("Y")).as_string()));
     }
 
+    void test_work_lists()
+    {
+        const Table &t = r_.table(_T("A"));
+        Session session(r_);
+        DataObject::Ptr d = DataObject::create_new(t);
+        session.save(d);
+        CPPUNIT_ASSERT_EQUAL((size_t)1, session.new_objs_[&t].size());
+        DataObject::Ptr e = DataObject::create_new(t, DataObject::Sync);
+        e->set(_T("X"), 10);
+        session.save(e);
+        CPPUNIT_ASSERT(session.dirty_objs_.empty());
+        e->set(_T("Y"), String(_T("abc")));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, session.dirty_objs_[&t].size());
+        e->set(_T("Y"), Value());
+        CPPUNIT_ASSERT(session.dirty_objs_.empty());
+        e->delete_object(DelUnchecked);
+        CPPUNIT_ASSERT_EQUAL((size_t)1, session.to_delete_objs_[&t].size());
+        d->delete_object(DelUnchecked);
+        CPPUNIT_ASSERT(session.new_objs_.empty());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, session.deleted_objs_[&t].size());
+        session.detach(e);
+        CPPUNIT_ASSERT(session.to_delete_objs_.empty());
+        session.get_lazy(t.mk_key(20));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, session.ghost_objs_[&t].size());
+    }
+
+    void test_identity_map()
+    {
+        const Table &t = r_.table(_T("A"));
+        IdentityMap idmap;
+        DataObjectList objs;
+        for (int i = 0; i < 1000; ++i) {
+            DataObject::Ptr d = DataObject::create_new(t);
+            d->set(_T("X"), i);
+            objs.push_back(d);
+            CPPUNIT_ASSERT(shptr_get(d) == idmap.insert(shptr_get(d)));
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)1000, idmap.size());
+        DataObject::Ptr e = DataObject::create_new(t);
+        e->set(_T("X"), 10);
+        CPPUNIT_ASSERT(shptr_get(objs[10]) == idmap.insert(shptr_get(e)));
+        CPPUNIT_ASSERT(!idmap.erase(e->key(), shptr_get(e)));
+        for (int i = 0; i < 1000; i += 2)
+            CPPUNIT_ASSERT(idmap.erase(t.mk_key(i)));
+        CPPUNIT_ASSERT_EQUAL((size_t)500, idmap.size());
+        for (int i = 0; i < 1000; ++i) {
+            DataObject *found = idmap.find(t.mk_key(i));
+            if (i % 2)
+                CPPUNIT_ASSERT(shptr_get(objs[i]) == found);
+            else
+                CPPUNIT_ASSERT(found == NULL);
+        }
+        CPPUNIT_ASSERT(idmap.find(r_.table(_T("B")).mk_key(1)) == NULL);
+    }
+
+    void test_session_arena()
+    {
+        const Table &t = r_.table(_T("A"));
+        Session session(r_);
+        session.use_arena();
+        Arena *arena = session.arena();
+        for (int i = 1; i <= 100; ++i)
+            session.get_lazy(t.mk_key(i));
+        CPPUNIT_ASSERT_EQUAL((size_t)100, arena->alloc_count());
+        size_t blocks = arena->block_count();
+        CPPUNIT_ASSERT(blocks < 100 / 4);
+        DataObject::Ptr d = session.get_lazy(t.mk_key(1));
+        DataObject::Ptr e = DataObject::create_new(
+                r_.table(_T("B")), DataObject::New, arena);
+        session.save(e);
+        DataObject::link_slave_to_master(e, d);
+        // RelationObject comes from the arena too
+        CPPUNIT_ASSERT_EQUAL((size_t)102, arena->alloc_count());
+        session.detach(session.get_lazy(t.mk_key(50)));
+        // The chunk of the detached object is reused
+        session.get_lazy(t.mk_key(101));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, arena->reuse_count());
+        CPPUNIT_ASSERT_EQUAL(blocks, arena->block_count());
+    }
+
+    void test_relation_slots()
+    {
+        const Table &a = r_.table(_T("A")), &b = r_.table(_T("B"));
+        CPPUNIT_ASSERT_EQUAL(2, a.rel_count(0));
+        CPPUNIT_ASSERT_EQUAL(1, a.rel_count(1));
+        CPPUNIT_ASSERT_EQUAL(0, b.rel_count(0));
+        CPPUNIT_ASSERT_EQUAL(1, b.rel_count(1));
+        const Relation *re = r_.find_relation(_T("A"), _T("ChildAs"));
+        CPPUNIT_ASSERT_EQUAL(1, re->ordinal(0));
+        CPPUNIT_ASSERT_EQUAL(0, re->ordinal(1));
+        DataObject::Ptr d = DataObject::create_new(a),
+            e = DataObject::create_new(a);
+        DataObject::link_slave_to_master(e, d, _T("ParA"));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, d->master_relations().size());
+        CPPUNIT_ASSERT(d->master_relations().begin()->first == re);
+        CPPUNIT_ASSERT(d->master_relations().find(re) !=
+                       d->master_relations().end());
+        CPPUNIT_ASSERT(e->master_relations().find(re) ==
+                       e->master_relations().end());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, e->slave_relations().size());
+    }
+
+    void test_dirty_columns()
+    {
+        DataObject::Ptr d = DataObject::create_new(r_.table(_T("A")),
+                                                   DataObject::Sync);
+        d->set(_T("Y"), Value(_T("ab")));
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Dirty, (int)d->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)4, d->dirty_columns().size());
+        CPPUNIT_ASSERT(!d->dirty_columns()[0]);
+        CPPUNIT_ASSERT(d->dirty_columns()[1]);
+        CPPUNIT_ASSERT(!d->dirty_columns()[2]);
+        d->set(_T("P"), Value(1));
+        CPPUNIT_ASSERT(d->dirty_columns()[2]);
+        d->set(_T("Y"), Value(_T("cd")));
+        d->set(_T("Y"), Value());
+        CPPUNIT_ASSERT(!d->dirty_columns()[1]);
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Dirty, (int)d->status());
+        d->set(_T("P"), Value());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)d->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)0, d->dirty_columns().size());
+        d->set(_T("P"), Value(2));
+        d->touch();
+        d->set(_T("P"), Value());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Dirty, (int)d->status());
+        CPPUNIT_ASSERT(d->dirty_columns()[1]);
+    }
+
     void test_data_object_cant_change_key_if_saved()
     {
         DataObject::Ptr d = DataObject::create_new(r_.table(_T("A")));
@@ -364,6 +507,25 @@ public:
         CPPUNIT_ASSERT_EQUAL(string("C.U = 'YYY'"), NARROW(kf2.get_sql()));
     }
 
+    void test_filter_by_keys()
+    {
+        String tbl_a = _T("A"), col_x = _T("X"),
+               tbl_c = _T("C"), col_u = _T("U");
+        Keys keys;
+        keys.push_back(Key(&tbl_a, &col_x, 10));
+        CPPUNIT_ASSERT_EQUAL(string("A.X = 10"),
+                             NARROW(KeysFilter(keys).get_sql()));
+        keys.push_back(Key(&tbl_a, &col_x, 20));
+        keys.push_back(Key(&tbl_a, &col_x, 30));
+        CPPUNIT_ASSERT_EQUAL(string("A.X IN (10, 20, 30)"),
+                             NARROW(KeysFilter(keys).get_sql()));
+        Keys keys2(2, Key(&tbl_c));
+        keys2[0].fields.push_back(std::make_pair(&col_u, Value(_T("YYY"))));
+        keys2[1].fields.push_back(std::make_pair(&col_u, Value(_T("ZZZ"))));
+        CPPUNIT_ASSERT_EQUAL(string("(C.U = 'YYY') OR (C.U = 'ZZZ')"),
+                             NARROW(KeysFilter(keys2).get_sql()));
+    }
+
     /*
     void test_bad_type_cast_format()
     {
@@ -421,14 +583,22 @@ class TestDataObjectSaveLoad : public CppUnit::TestFixture
     CPPUNIT_TEST(test_lazy_load);
     //CPPUNIT_TEST_EXCEPTION(test_lazy_load_fail, ObjectNotFoundByKey);
     CPPUNIT_TEST(test_lazy_load_fail);
+    CPPUNIT_TEST(test_lazy_load_batch);
+    CPPUNIT_TEST(test_lazy_load_batch_size);
     CPPUNIT_TEST(test_lazy_load_slaves);
+    CPPUNIT_TEST(test_lazy_load_slaves_batch);
     CPPUNIT_TEST(test_flush_dirty);
+    CPPUNIT_TEST(test_flush_dirty_columns);
+    CPPUNIT_TEST(test_flush_dirty_created);
+    CPPUNIT_TEST(test_flush_dirty_created_set);
+    CPPUNIT_TEST(test_object_cache);
     CPPUNIT_TEST(test_flush_new);
     CPPUNIT_TEST(test_flush_new_with_id);
     CPPUNIT_TEST(test_flush_new_linked);
     CPPUNIT_TEST(test_flush_new_linked_to_existing);
     CPPUNIT_TEST(test_flush_deleted);
     CPPUNIT_TEST(test_domain_object);
+    CPPUNIT_TEST(test_blob_stream);
     CPPUNIT_TEST_SUITE_END();
 
     Schema r_;
@@ -497,6 +667,15 @@ public:
 "        </column>"
 "        <column name='B' type='decimal'/>"
 "    </table>"
+"    <table name='T_ORM_BLOB' class='OrmBlob' xml-name='orm-blob'>"
+"        <column name='ID' type='longint'>"
+"            <primary-key />"
+"        </column>"
+"        <column name='NAME' type='string' size='100' />"
+"        <column name='DATA' type='blob'>"
+"            <lazy />"
+"        </column>"
+"    </table>"
 "    <relation type='one-to-many'>"
 "        <one class='OrmTest' />"
 "        <many class='OrmXml' property='orm_test' />"
@@ -516,6 +695,7 @@ public:
         conn.begin_trans_if_necessary();
         conn.exec_direct(_T("DELETE FROM T_ORM_XML"));
         conn.exec_direct(_T("DELETE FROM T_ORM_TEST"));
+        conn.exec_direct(_T("DELETE FROM T_ORM_BLOB"));
         conn.grant_insert_id(_T("T_ORM_TEST"), false, true);
         conn.grant_insert_id(_T("T_ORM_XML"), false, true);
         conn.commit();
@@ -568,6 +748,44 @@ public:
         }
     }
 
+    void test_lazy_load_batch()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(r_, &engine);
+        const Table &t = r_.table(_T("T_ORM_XML"));
+        DataObject::Ptr e = session.get_lazy(t.mk_key(-20)),
+            f = session.get_lazy(t.mk_key(-30)),
+            g = session.get_lazy(t.mk_key(-40));
+        CPPUNIT_ASSERT(Decimal(_T("3.14")) == e->get(_T("B")).as_decimal());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)e->status());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)f->status());
+        CPPUNIT_ASSERT(Decimal(_T("2.7")) == f->raw_values()[2].as_decimal());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Ghost, (int)g->status());
+        bool not_found = false;
+        try {
+            g->get(_T("B"));
+        }
+        catch (const ObjectNotFoundByKey &) {
+            not_found = true;
+        }
+        CPPUNIT_ASSERT(not_found);
+    }
+
+    void test_lazy_load_batch_size()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(r_, &engine);
+        session.set_load_batch_size(1);
+        const Table &t = r_.table(_T("T_ORM_XML"));
+        DataObject::Ptr e = session.get_lazy(t.mk_key(-20)),
+            f = session.get_lazy(t.mk_key(-30));
+        CPPUNIT_ASSERT(Decimal(_T("3.14")) == e->get(_T("B")).as_decimal());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)e->status());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Ghost, (int)f->status());
+    }
+
     void test_lazy_load_slaves()
     {
         Engine engine(Engine::READ_ONLY);
@@ -586,6 +804,210 @@ public:
         CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
     }
 
+    void test_lazy_load_slaves_batch()
+    {
+        Key k;
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = DataObject::create_new(r_.table(_T("T_ORM_TEST")));
+            d->set(_T("A"), Value(_T("abc")));
+            DataObject::Ptr e = DataObject::create_new(r_.table(_T("T_ORM_XML")));
+            e->set(_T("B"), Value(Decimal(_T("0.01"))));
+            DataObject::link_slave_to_master(e, d);
+            session.save(d);
+            session.save(e);
+            session.flush();
+            k = d->key();
+            engine.commit();
+        }
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(r_, &engine);
+        DataObject::Ptr d = session.get_lazy
+            (r_.table(_T("T_ORM_TEST")).mk_key(-10));
+        DataObject::Ptr f = session.get_lazy(k);
+        RelationObject *ro = d->get_slaves();
+        ro->lazy_load_slaves();
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, ro->slave_objects().size());
+        RelationObject *ro2 = f->get_slaves();
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro2->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, ro2->slave_objects().size());
+        CPPUNIT_ASSERT(Decimal(_T("0.01")) ==
+                       ro2->slave_objects()[0]->get(_T("B")).as_decimal());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Ghost, (int)f->status());
+    }
+
+    void test_flush_dirty_columns()
+    {
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = session.get_lazy(r_.table(_T("T_ORM_TEST")).mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("item"), NARROW(d->get(_T("A")).as_string()));
+            d->set(_T("A"), Value(_T("xyz")));
+            // column C is changed behind the session's back
+            engine.get_conn()->exec_direct(
+                    _T("UPDATE T_ORM_TEST SET C = 9 WHERE ID = -10"));
+            session.flush();
+            engine.commit();
+        }
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = session.get_lazy(r_.table(_T("T_ORM_TEST")).mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("xyz"), NARROW(d->get(_T("A")).as_string()));
+            CPPUNIT_ASSERT_EQUAL(string("9"), NARROW(d->get(_T("C")).as_string()));
+            d->set(_T("A"), Value(_T("abc")));
+            d->set(_T("A"), Value(_T("xyz")));
+            CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)d->status());
+        }
+    }
+
+    void test_flush_dirty_created()
+    {
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            // No changes are tracked, so all the columns get updated
+            DataObject::Ptr d = DataObject::create_new(
+                    r_.table(_T("T_ORM_TEST")), DataObject::Dirty);
+            d->get(_T("ID")) = Value(-10);
+            d->get(_T("A")) = Value(_T("xyz"));
+            d->get(_T("B")) = Value(now());
+            d->get(_T("C")) = Value(Decimal(_T("9")));
+            d->get(_T("D")) = Value(7.5);
+            CPPUNIT_ASSERT_EQUAL((size_t)0, d->dirty_columns().size());
+            session.save(d);
+            session.flush();
+            CPPUNIT_ASSERT_EQUAL((int)DataObject::Ghost, (int)d->status());
+            engine.commit();
+        }
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = session.get_lazy(r_.table(_T("T_ORM_TEST")).mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("xyz"), NARROW(d->get(_T("A")).as_string()));
+            CPPUNIT_ASSERT_EQUAL(string("9"), NARROW(d->get(_T("C")).as_string()));
+        }
+    }
+
+    void test_flush_dirty_created_set()
+    {
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = DataObject::create_new(
+                    r_.table(_T("T_ORM_TEST")), DataObject::Dirty);
+            d->get(_T("ID")) = Value(-10);
+            d->get(_T("B")) = Value(now());
+            d->get(_T("C")) = Value(Decimal(_T("9")));
+            d->get(_T("D")) = Value(7.5);
+            // The columns filled before are not forgotten
+            d->set(_T("A"), Value(_T("xyz")));
+            CPPUNIT_ASSERT(d->dirty_columns()[1]);
+            CPPUNIT_ASSERT(d->dirty_columns()[3]);
+            CPPUNIT_ASSERT(d->dirty_columns()[4]);
+            session.save(d);
+            session.flush();
+            engine.commit();
+        }
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = session.get_lazy(r_.table(_T("T_ORM_TEST")).mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("xyz"), NARROW(d->get(_T("A")).as_string()));
+            CPPUNIT_ASSERT_EQUAL(string("9"), NARROW(d->get(_T("C")).as_string()));
+            CPPUNIT_ASSERT_EQUAL(7.5, d->get(_T("D")).as_float());
+        }
+    }
+
+    void test_object_cache()
+    {
+        MetaDataConfig cfg(
+"<?xml version='1.0' encoding='UTF-8'?>"
+"<schema>"
+"    <table name='T_ORM_TEST' cache-ttl='60' cache-size='10'>"
+"        <column name='ID' type='longint'>"
+"            <primary-key />"
+"        </column>"
+"        <column name='A' type='string' size='200' />"
+"        <column name='B' type='datetime' />"
+"        <column name='C' type='decimal'/>"
+"        <column name='D' type='float'/>"
+"    </table>"
+"</schema>");
+        Schema r;
+        cfg.parse(r);
+        r.fill_fkeys();
+        const Table &t = r.table(_T("T_ORM_TEST"));
+        CPPUNIT_ASSERT(t.cached());
+        CPPUNIT_ASSERT_EQUAL(60, t.cache_ttl());
+        CPPUNIT_ASSERT_EQUAL(10, t.cache_size());
+        ObjectCache &cache = theObjectCache();
+        cache.clear();
+        {
+            Engine engine(Engine::READ_ONLY);
+            setup_log(engine);
+            Session session(r, &engine);
+            DataObject::Ptr d = session.get_lazy(t.mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("item"), NARROW(d->get(_T("A")).as_string()));
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+        {
+            // the rows of another data source are kept apart
+            Values values;
+            CPPUNIT_ASSERT(!cache.get(_T("other"), t, t.mk_key(-10), values));
+        }
+        {
+            Engine engine;
+            setup_log(engine);
+            // the row is changed behind the cache's back
+            engine.get_conn()->exec_direct(
+                    _T("UPDATE T_ORM_TEST SET A = 'abc' WHERE ID = -10"));
+            engine.commit();
+        }
+        {
+            Engine engine;
+            setup_log(engine);
+            Session session(r, &engine);
+            DataObject::Ptr d = session.get_lazy(t.mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("item"), NARROW(d->get(_T("A")).as_string()));
+            CPPUNIT_ASSERT_EQUAL((size_t)1, cache.hits());
+            d->set(_T("A"), Value(_T("xyz")));
+            session.flush();
+            CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+            {
+                // the old row is not put back until the change is over
+                Engine engine2(Engine::READ_ONLY);
+                setup_log(engine2);
+                Session session2(r, &engine2);
+                DataObject::Ptr d2 = session2.get_lazy(t.mk_key(-10));
+                d2->get(_T("A"));
+                CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+            }
+            engine.commit();
+        }
+        {
+            Engine engine(Engine::READ_ONLY);
+            setup_log(engine);
+            Session session(r, &engine);
+            DataObject::Ptr d = session.get_lazy(t.mk_key(-10));
+            CPPUNIT_ASSERT_EQUAL(string("xyz"), NARROW(d->get(_T("A")).as_string()));
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.hits());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+        cache.clear();
+    }
+
     void test_flush_dirty()
     {
         {
@@ -815,6 +1237,40 @@ public:
         f.save(session);
         f.link_to_master(d);
     }
+
+    void test_blob_stream()
+    {
+        string data(100000, 'x');
+        data[1] = '\0';
+        {
+            Engine engine(Engine::READ_WRITE);
+            setup_log(engine);
+            Session session(r_, &engine);
+            DataObject::Ptr d = DataObject::create_new(
+                    r_.table(_T("T_ORM_BLOB")));
+            d->set(_T("ID"), Value(-40));
+            d->set(_T("NAME"), Value(_T("a.bin")));
+            session.save(d);
+            // the new object gets flushed first
+            istringstream in(data);
+            d->blob_stream(_T("DATA")).write(in, data.size());
+            session.commit();
+        }
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        Session session(r_, &engine);
+        DataObject::Ptr d = session.get_lazy(
+                r_.table(_T("T_ORM_BLOB")).mk_key(-40));
+        CPPUNIT_ASSERT_EQUAL(string("a.bin"),
+                             NARROW(d->get(_T("NAME")).as_string()));
+        CPPUNIT_ASSERT(d->get(_T("DATA")).is_null());
+        // updating all the columns leaves the lazy one alone
+        d->touch();
+        session.flush();
+        ostringstream out;
+        CPPUNIT_ASSERT(d->blob_stream(_T("DATA")).read(out));
+        CPPUNIT_ASSERT(data == out.str());
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestDataObjectSaveLoad);
@@ -10,6 +10,8 @@
 #define ORM_XML_ID2 -20
 #define ORM_XML_ID3 -30
 #define ORM_XML_ID4 -40
+#define ORM_BLOB_ID5 -50
+#define ORM_BLOB_ID6 -60
 
 class OrmXml;
 
@@ -37,8 +39,17 @@ YB_DECLARE(OrmXml, "T_ORM_XML", "S_ORM_XML_ID", "orm-xml",
     YB_COL_END)
 };
 
+class OrmBlob: public Yb::DomainObject {
+
+YB_DECLARE(OrmBlob, "T_ORM_BLOB", "", "orm-blob",
+    YB_COL_PK(id, "ID")
+    YB_COL_STR(name, "NAME", 100)
+    YB_COL_END)
+};
+
 YB_DEFINE(OrmTest)
 YB_DEFINE(OrmXml)
+YB_DEFINE(OrmBlob)
 
 using namespace std;
 using namespace Yb;
@@ -85,6 +96,16 @@ class TestDomainObject : public CppUnit::TestFixture
 #if defined(YB_USE_TUPLE)
     CPPUNIT_TEST(test_explicit_join3);
 #endif // defined(YB_USE_TUPLE)
+    CPPUNIT_TEST(test_eager_slaves);
+    CPPUNIT_TEST(test_eager_master);
+    CPPUNIT_TEST(test_eager_slaves_range);
+    CPPUNIT_TEST_EXCEPTION(test_eager_no_relation, NoRelationFound);
+    CPPUNIT_TEST_EXCEPTION(test_eager_bad_relation_name, NoRelationFound);
+#if defined(YB_USE_TUPLE)
+    CPPUNIT_TEST(test_eager_slaves_tuple);
+#endif // defined(YB_USE_TUPLE)
+    CPPUNIT_TEST(test_stateless_session);
+    CPPUNIT_TEST(test_query_cache);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -134,6 +155,17 @@ public:
             conn.exec(params);
         }
         conn.grant_insert_id(_T("T_ORM_XML"), false, true);
+        {
+            String sql_str =
+                _T("INSERT INTO T_ORM_BLOB(ID, NAME) VALUES (?, ?)");
+            conn.prepare(sql_str);
+            Values params(2);
+            params[0] = Value(ORM_BLOB_ID5);
+            params[1] = Value(_T("item"));
+            conn.exec(params);
+            params[0] = Value(ORM_BLOB_ID6);
+            conn.exec(params);
+        }
         conn.commit();
 
         Yb::init_schema();
@@ -144,6 +176,7 @@ public:
         SqlConnection conn(Engine::sql_source_from_env());
         setup_log(conn);
         conn.begin_trans_if_necessary();
+        conn.exec_direct(_T("DELETE FROM T_ORM_BLOB"));
         conn.exec_direct(_T("DELETE FROM T_ORM_XML"));
         conn.exec_direct(_T("DELETE FROM T_ORM_TEST"));
         conn.grant_insert_id(_T("T_ORM_TEST"), false, true);
@@ -322,6 +355,173 @@ public:
         CPPUNIT_ASSERT_EQUAL(3, (int)session.identity_map_.size());
     }
 #endif // defined(YB_USE_TUPLE)
+
+    void test_eager_slaves()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        DomainResultSet<OrmTest> rs = Yb::query<OrmTest>(session)
+            .with<OrmXml>()
+            .all();
+        vector<OrmTest> out;
+        copy(rs.begin(), rs.end(), back_inserter(out));
+        CPPUNIT_ASSERT_EQUAL(1, (int)out.size());
+        RelationObject *ro = out[0].get_data_object()->get_slaves(
+                _T("orm_xmls"));
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, ro->slave_objects().size());
+        CPPUNIT_ASSERT_EQUAL(2, (int)out[0].orm_xmls.size());
+        ///
+        CPPUNIT_ASSERT_EQUAL(3, (int)session.objects_.size());
+        CPPUNIT_ASSERT_EQUAL(3, (int)session.identity_map_.size());
+    }
+
+    void test_eager_no_relation()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Session session(Yb::theSchema(), &engine);
+        Yb::query<OrmTest>(session).with<OrmBlob>();
+    }
+
+    void test_eager_bad_relation_name()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Session session(Yb::theSchema(), &engine);
+        Yb::query<OrmTest>(session).with<OrmXml>(_T("no_such_relation"));
+    }
+
+    void test_eager_master()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        DomainResultSet<OrmXml> rs = Yb::query<OrmXml>(session)
+            .with<OrmTest>()
+            .order_by(OrmXml::c.id)
+            .all();
+        vector<OrmXml> out;
+        copy(rs.begin(), rs.end(), back_inserter(out));
+        CPPUNIT_ASSERT_EQUAL(3, (int)out.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)0,
+                out[0].get_data_object()->slave_relations().size());
+        CPPUNIT_ASSERT_EQUAL((size_t)1,
+                out[1].get_data_object()->slave_relations().size());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync,
+                (int)out[1].orm_test->get_data_object()->status());
+        CPPUNIT_ASSERT(out[1].orm_test->get_data_object() ==
+                       out[2].orm_test->get_data_object());
+        ///
+        CPPUNIT_ASSERT_EQUAL(4, (int)session.objects_.size());
+        CPPUNIT_ASSERT_EQUAL(4, (int)session.identity_map_.size());
+    }
+
+    void test_eager_slaves_range()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        // the page cuts the collection of two after its first row
+        DomainResultSet<OrmTest> rs = Yb::query<OrmTest>(session)
+            .with<OrmXml>()
+            .range(0, 1)
+            .all();
+        vector<OrmTest> out;
+        copy(rs.begin(), rs.end(), back_inserter(out));
+        CPPUNIT_ASSERT_EQUAL(1, (int)out.size());
+        RelationObject *ro = out[0].get_data_object()->get_slaves(
+                _T("orm_xmls"));
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Incomplete,
+                (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL(2, (int)out[0].orm_xmls.size());
+        ro->lazy_load_slaves();
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, ro->slave_objects().size());
+    }
+
+#if defined(YB_USE_TUPLE)
+    void test_eager_slaves_tuple()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        // each of the two tuples brings the same pair of slaves
+        DomainResultSet<boost::tuple<OrmTest, OrmBlob> > rs =
+            Yb::query<boost::tuple<OrmTest, OrmBlob> >(session)
+            .select_from<OrmTest>()
+            .join<OrmBlob>(OrmBlob::c.name == OrmTest::c.a)
+            .with<OrmXml>()
+            .all();
+        vector<boost::tuple<OrmTest, OrmBlob> > out;
+        copy(rs.begin(), rs.end(), back_inserter(out));
+        CPPUNIT_ASSERT_EQUAL(2, (int)out.size());
+        CPPUNIT_ASSERT(out[0].get<0>() == out[1].get<0>());
+        CPPUNIT_ASSERT(out[0].get<1>() != out[1].get<1>());
+        RelationObject *ro = out[0].get<0>().get_data_object()->get_slaves(
+                _T("orm_xmls"));
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, ro->slave_objects().size());
+        ///
+        CPPUNIT_ASSERT_EQUAL(5, (int)session.objects_.size());
+        CPPUNIT_ASSERT_EQUAL(5, (int)session.identity_map_.size());
+    }
+#endif // defined(YB_USE_TUPLE)
+
+    void test_stateless_session()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        session.set_stateless();
+        DomainResultSet<OrmTest> rs = Yb::query<OrmTest>(session)
+            .with<OrmXml>()
+            .all();
+        vector<OrmTest> out;
+        copy(rs.begin(), rs.end(), back_inserter(out));
+        CPPUNIT_ASSERT_EQUAL(1, (int)out.size());
+        DataObject::Ptr d = out[0].get_data_object();
+        CPPUNIT_ASSERT(!d->session());
+        CPPUNIT_ASSERT_EQUAL((int)DataObject::Sync, (int)d->status());
+        RelationObject *ro = d->get_slaves(_T("orm_xmls"));
+        CPPUNIT_ASSERT_EQUAL((int)RelationObject::Sync, (int)ro->status());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, ro->slave_objects().size());
+        ///
+        CPPUNIT_ASSERT_EQUAL(0, (int)session.objects_.size());
+        CPPUNIT_ASSERT_EQUAL(0, (int)session.identity_map_.size());
+        bool refused = false;
+        try {
+            session.save(d);
+        }
+        catch (const ReadOnlySession &) {
+            refused = true;
+        }
+        CPPUNIT_ASSERT(refused);
+    }
+
+    void test_query_cache()
+    {
+        Engine engine(Engine::READ_ONLY);
+        setup_log(engine);
+        Session session(Yb::theSchema(), &engine);
+        QueryCache &cache = Yb::theSchema().query_cache();
+        cache.clear();
+        LongInt ids[] = {ORM_XML_ID2, ORM_XML_ID3};
+        for (int i = 0; i < 2; ++i) {
+            // only the constant differs, so the SQL is reused
+            OrmXml x = Yb::query<OrmXml>(session)
+                .filter_by(OrmXml::c.id == ids[i]).one();
+            CPPUNIT_ASSERT_EQUAL(ids[i], x.id.value());
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.misses());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, cache.hits());
+        cache.set_enabled(false);
+        OrmXml x = Yb::query<OrmXml>(session)
+            .filter_by(OrmXml::c.id == ORM_XML_ID4).one();
+        CPPUNIT_ASSERT_EQUAL((LongInt)ORM_XML_ID4, x.id.value());
+        CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+        cache.set_enabled(true);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestDomainObject);
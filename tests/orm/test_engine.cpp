@@ -1,8 +1,10 @@
 #include <algorithm>
+#include <sstream>
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/TestAssert.h>
 #include "util/string_utils.h"
 #include "orm/engine.h"
+#include "orm/id_generator.h"
 
 using namespace std;
 using namespace Yb;
@@ -36,17 +38,34 @@ class TestEngine : public CppUnit::TestFixture
     CPPUNIT_TEST_EXCEPTION(test_select_having_wo_groupby, BadSQLOperation);
     CPPUNIT_TEST(test_insert_simple);
     CPPUNIT_TEST(test_insert_exclude);
+    CPPUNIT_TEST(test_insert_multi_row);
+    CPPUNIT_TEST(test_insert_all);
+    CPPUNIT_TEST(test_insert_returning);
     CPPUNIT_TEST(test_update_where);
     CPPUNIT_TEST(test_update_combo);
+    CPPUNIT_TEST(test_update_columns);
     CPPUNIT_TEST_EXCEPTION(test_update_wo_clause, BadSQLOperation);
     CPPUNIT_TEST(test_delete);
+    CPPUNIT_TEST(test_delete_many_keys);
+    CPPUNIT_TEST(test_delete_composite_keys);
     CPPUNIT_TEST_EXCEPTION(test_delete_wo_pk, BadSQLOperation);
     CPPUNIT_TEST_EXCEPTION(test_insert_ro_mode, BadOperationInMode);
     CPPUNIT_TEST_EXCEPTION(test_update_ro_mode, BadOperationInMode);
     CPPUNIT_TEST_EXCEPTION(test_delete_ro_mode, BadOperationInMode);
     CPPUNIT_TEST_EXCEPTION(test_execpoc_ro_mode, BadOperationInMode);
+    CPPUNIT_TEST(test_hilo_id_generator);
+    CPPUNIT_TEST(test_id_generator_conflict);
     CPPUNIT_TEST_SUITE_END();
 
+    class CountingHiLo: public HiLoIdGenerator
+    {
+    protected:
+        LongInt next_hi(EngineBase &) { return ++hi; }
+    public:
+        LongInt hi;
+        CountingHiLo(int block): HiLoIdGenerator(_T("S_T"), block), hi(0) {}
+    };
+
 public:
     void test_strlist_one()
     {
@@ -252,6 +271,67 @@ public:
         CPPUNIT_ASSERT_EQUAL((int)Value::LONGINT, types[0]);
     }
 
+    void test_insert_multi_row()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 0, 0));
+        String sql;
+        TypeCodes types;
+        ParamNums param_nums;
+        engine.gen_sql_insert(sql, types, param_nums, t, true, true,
+                              2, INSERT_VALUES_LIST);
+        CPPUNIT_ASSERT_EQUAL(string("INSERT INTO T (ID, A) VALUES "
+                                    "(:1, :2), (:3, :4)"), NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL(4, (int)types.size());
+        CPPUNIT_ASSERT_EQUAL(2, (int)param_nums.size());
+        CPPUNIT_ASSERT_EQUAL(1, (int)param_nums[_T("A")]);
+        CPPUNIT_ASSERT_EQUAL((int)Value::LONGINT, types[2]);
+        CPPUNIT_ASSERT_EQUAL((int)Value::STRING, types[3]);
+    }
+
+    void test_insert_all()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 0, 0));
+        String sql;
+        TypeCodes types;
+        ParamNums param_nums;
+        engine.gen_sql_insert(sql, types, param_nums, t, true, false,
+                              2, INSERT_ALL);
+        CPPUNIT_ASSERT_EQUAL(string("INSERT ALL INTO T (ID, A) VALUES (?, ?) "
+                                    "INTO T (ID, A) VALUES (?, ?) "
+                                    "SELECT * FROM DUAL"), NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL(4, (int)types.size());
+    }
+
+    void test_insert_returning()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 0, 0));
+        String sql;
+        TypeCodes types;
+        ParamNums param_nums;
+        engine.gen_sql_insert(sql, types, param_nums, t, false, false,
+                              1, INSERT_VALUES_LIST, RETURNING_CLAUSE);
+        CPPUNIT_ASSERT_EQUAL(string("INSERT INTO T (A) VALUES (?) "
+                                    "RETURNING ID"), NARROW(sql));
+        engine.gen_sql_insert(sql, types, param_nums, t, false, false,
+                              1, INSERT_VALUES_LIST, RETURNING_OUTPUT_INTO);
+        CPPUNIT_ASSERT_EQUAL(string("SET NOCOUNT ON; "
+                                    "DECLARE @NEW_IDS TABLE (ID BIGINT); "
+                                    "INSERT INTO T (A) OUTPUT INSERTED.ID "
+                                    "INTO @NEW_IDS VALUES (?); "
+                                    "SET NOCOUNT OFF; "
+                                    "SELECT ID FROM @NEW_IDS"), NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL(1, (int)types.size());
+    }
+
     void test_update_where()
     {
         Engine engine(Engine::READ_ONLY);
@@ -302,6 +382,28 @@ public:
         CPPUNIT_ASSERT_EQUAL((int)Value::DECIMAL, types[4]);
     }
 
+    void test_update_columns()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("Q"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("E"), Value::STRING, 0, 0));
+        t.add_column(Column(_T("F"), Value::FLOAT, 0, 0));
+        t.add_column(Column(_T("G"), Value::DECIMAL, 0, 0));
+        String sql;
+        TypeCodes types;
+        ParamNums param_nums;
+        SqlGeneratorOptions options(NO_QUOTES, true, true);
+        vector<bool> columns(4);
+        columns[2] = true;
+        engine.gen_sql_update(sql, types, param_nums, t, options, &columns);
+        CPPUNIT_ASSERT_EQUAL(string("UPDATE T SET F = ? WHERE T.Q = ?"), NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL((size_t)2, types.size());
+        CPPUNIT_ASSERT_EQUAL(0, param_nums[_T("F")]);
+        CPPUNIT_ASSERT_EQUAL(1, param_nums[_T("Q")]);
+        CPPUNIT_ASSERT_EQUAL((int)Value::FLOAT, types[0]);
+    }
+
     void test_update_wo_clause()
     {
         Engine engine(Engine::READ_ONLY);
@@ -329,6 +431,39 @@ public:
         CPPUNIT_ASSERT_EQUAL((int)Value::LONGINT, types[0]);
     }
 
+    void test_delete_many_keys()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        String sql;
+        TypeCodes types;
+        SqlGeneratorOptions options(NO_QUOTES, true, true);
+        engine.gen_sql_delete(sql, types, t, options, 3);
+        CPPUNIT_ASSERT_EQUAL(string("DELETE FROM T WHERE T.ID IN (?, ?, ?)"),
+                NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL((size_t)3, types.size());
+        CPPUNIT_ASSERT_EQUAL((int)Value::LONGINT, types[2]);
+    }
+
+    void test_delete_composite_keys()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table t(_T("T"));
+        t.add_column(Column(_T("A"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("B"), Value::STRING, 10, Column::PK));
+        String sql;
+        TypeCodes types;
+        SqlGeneratorOptions options(NO_QUOTES, true, true);
+        engine.gen_sql_delete(sql, types, t, options, 2);
+        CPPUNIT_ASSERT_EQUAL(string("DELETE FROM T WHERE "
+                    "((T.A = ?) AND (T.B = ?)) OR ((T.A = ?) AND (T.B = ?))"),
+                NARROW(sql));
+        CPPUNIT_ASSERT_EQUAL((size_t)4, types.size());
+        CPPUNIT_ASSERT_EQUAL((int)Value::LONGINT, types[2]);
+        CPPUNIT_ASSERT_EQUAL((int)Value::STRING, types[3]);
+    }
+
     void test_delete_wo_pk()
     {
         Engine engine(Engine::READ_ONLY);
@@ -368,6 +503,37 @@ public:
         Engine engine(Engine::READ_ONLY);
         engine.exec_proc(_T(""));
     }
+
+    void test_hilo_id_generator()
+    {
+        Engine engine(Engine::READ_ONLY);
+        CountingHiLo gen(3);
+        LongInt ids[] = {3, 4, 5, 6, 7, 8, 9};
+        for (int i = 0; i < 7; ++i)
+            CPPUNIT_ASSERT_EQUAL(ids[i], gen.next_id(engine));
+        CPPUNIT_ASSERT_EQUAL((LongInt)3, gen.hi);
+    }
+
+    void test_id_generator_conflict()
+    {
+        Engine engine(Engine::READ_ONLY);
+        Table a(_T("T_A")), b(_T("T_B")), c(_T("T_C"));
+        a.set_seq_name(_T("S_CONFLICT"));
+        a.set_id_generator(_T("hilo"), 100);
+        b.set_seq_name(_T("S_CONFLICT"));
+        b.set_id_generator(_T("hilo"), 100);
+        c.set_seq_name(_T("S_CONFLICT"));
+        IdGenerator &gen = table_id_generator(a, engine);
+        CPPUNIT_ASSERT(&gen == &table_id_generator(b, engine));
+        bool refused = false;
+        try {
+            table_id_generator(c, engine);
+        }
+        catch (const IdGeneratorConflict &) {
+            refused = true;
+        }
+        CPPUNIT_ASSERT(refused);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestEngine);
@@ -417,7 +583,17 @@ class TestEngineSql : public CppUnit::TestFixture
     CPPUNIT_TEST(test_select_sql);
     CPPUNIT_TEST(test_select_sql_max_rows);
     CPPUNIT_TEST(test_insert_sql);
+    CPPUNIT_TEST(test_insert_many_sql);
+    CPPUNIT_TEST(test_insert_new_ids_sql);
+    CPPUNIT_TEST(test_delete_many_sql);
     CPPUNIT_TEST(test_update_sql);
+    CPPUNIT_TEST(test_stmt_cache_sql);
+    CPPUNIT_TEST(test_fetch_values_sql);
+    CPPUNIT_TEST(test_longint_param_sql);
+    CPPUNIT_TEST(test_fetch_many_sql);
+    CPPUNIT_TEST(test_exec_batch_sql);
+    CPPUNIT_TEST(test_exec_batch_error_sql);
+    CPPUNIT_TEST(test_blob_stream_sql);
     CPPUNIT_TEST_SUITE_END();
 
     LongInt record_id_;
@@ -471,6 +647,210 @@ public:
                        find_in_row(*ptr->begin(), _T("C"))->second.as_decimal());
     }
 
+    void test_stmt_cache_sql()
+    {
+        SqlConnection conn(Engine::sql_source_from_env());
+        conn.set_convert_params(true);
+        setup_log(conn);
+        conn.set_stmt_cache_size(2);
+        String sql_a = _T("SELECT A FROM T_ORM_TEST WHERE ID = ?"),
+               sql_b = _T("SELECT B FROM T_ORM_TEST WHERE ID = ?"),
+               sql_c = _T("SELECT C FROM T_ORM_TEST WHERE ID = ?");
+        Values params(1, Value(record_id_));
+        for (int i = 0; i < 2; ++i) {
+            // the pending results are dropped on return to the cache
+            auto_ptr<SqlCursor> cursor = conn.new_cursor();
+            cursor->prepare(sql_a);
+            cursor->exec(params);
+            RowPtr row = cursor->fetch_row();
+            CPPUNIT_ASSERT_EQUAL(string("item"),
+                    NARROW(row->begin()->second.as_string()));
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)1, conn.stmt_cache_hits());
+        CPPUNIT_ASSERT_EQUAL((size_t)1, conn.stmt_cache_misses());
+        {
+            auto_ptr<SqlCursor> cursor = conn.new_cursor();
+            cursor->prepare(sql_b);
+            cursor->prepare(sql_a);
+            cursor->prepare(sql_c);
+        }
+        // B was the least recently used one, so it is evicted
+        CPPUNIT_ASSERT_EQUAL((size_t)2, conn.stmt_cache_count());
+        CPPUNIT_ASSERT_EQUAL((size_t)2, conn.stmt_cache_hits());
+        {
+            auto_ptr<SqlCursor> cursor = conn.new_cursor();
+            cursor->prepare(sql_b);
+        }
+        CPPUNIT_ASSERT_EQUAL((size_t)4, conn.stmt_cache_misses());
+        conn.clear_stmt_cache();
+        CPPUNIT_ASSERT_EQUAL((size_t)0, conn.stmt_cache_count());
+    }
+
+    void test_fetch_values_sql()
+    {
+        SqlConnection conn(Engine::sql_source_from_env());
+        conn.set_convert_params(true);
+        setup_log(conn);
+        auto_ptr<SqlCursor> cursor = conn.new_cursor();
+        cursor->prepare(_T("SELECT ID, A FROM T_ORM_TEST WHERE ID >= ? ORDER BY ID"));
+        Values params(1, Value(record_id_));
+        SqlResultSet rs = cursor->exec(params);
+        CPPUNIT_ASSERT(!rs.header().get());
+        Values values;
+        CPPUNIT_ASSERT(rs.fetch_values(values));
+        RowHeaderPtr header = rs.header();
+        CPPUNIT_ASSERT(header.get() != NULL);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, header->size());
+        CPPUNIT_ASSERT_EQUAL(string("A"), NARROW(header->name(1)));
+        CPPUNIT_ASSERT_EQUAL(1, header->idx_by_name(_T("A")));
+        CPPUNIT_ASSERT_EQUAL(-1, header->idx_by_name(_T("B")));
+        CPPUNIT_ASSERT_EQUAL(record_id_, values[0].as_longint());
+        CPPUNIT_ASSERT_EQUAL(string("item"), NARROW(values[1].as_string()));
+        CPPUNIT_ASSERT(!rs.fetch_values(values));
+        // the next execution gets a fresh header
+        cursor->exec(params);
+        RowPtr row = cursor->fetch_row();
+        CPPUNIT_ASSERT(cursor->header().get() != NULL);
+        CPPUNIT_ASSERT(cursor->header() != header);
+        CPPUNIT_ASSERT_EQUAL(string("A"), NARROW((*row)[1].first));
+    }
+
+    void test_longint_param_sql()
+    {
+        SqlConnection conn(Engine::sql_source_from_env());
+        conn.set_convert_params(true);
+        setup_log(conn);
+        conn.begin_trans_if_necessary();
+        // doesn't fit in 32 bits
+        LongInt id = record_id_ + 10000000000LL;
+        Values params;
+        params.push_back(Value(id));
+        params.push_back(Value(_T("long")));
+        conn.grant_insert_id(_T("T_ORM_TEST"), true, true);
+        conn.prepare(_T("INSERT INTO T_ORM_TEST(ID, A) VALUES(?, ?)"));
+        conn.exec(params);
+        conn.grant_insert_id(_T("T_ORM_TEST"), false, true);
+        conn.prepare(_T("SELECT ID, A FROM T_ORM_TEST WHERE ID = ?"));
+        conn.exec(Values(1, Value(id)));
+        RowPtr row = conn.fetch_row();
+        CPPUNIT_ASSERT(row.get() != NULL);
+        CPPUNIT_ASSERT_EQUAL(id, (*row)[0].second.as_longint());
+        CPPUNIT_ASSERT_EQUAL(string("long"),
+                NARROW((*row)[1].second.as_string()));
+        conn.commit();
+    }
+
+    void test_exec_batch_sql()
+    {
+        SqlConnection conn(Engine::sql_source_from_env());
+        conn.set_convert_params(true);
+        setup_log(conn);
+        conn.begin_trans_if_necessary();
+        LongInt id = get_next_test_id(&conn);
+        vector<Values> params_rows(3);
+        for (int i = 0; i < 3; ++i) {
+            params_rows[i].push_back(Value(id + i));
+            params_rows[i].push_back(i == 1? Value():
+                    Value(_T("batch ") + to_string(i)));
+            params_rows[i].push_back(Value(Decimal(i)));
+        }
+        conn.grant_insert_id(_T("T_ORM_TEST"), true, true);
+        auto_ptr<SqlCursor> cursor = conn.new_cursor();
+        cursor->prepare(_T("INSERT INTO T_ORM_TEST(ID, A, C) VALUES(?, ?, ?)"));
+        cursor->exec_batch(params_rows);
+        conn.grant_insert_id(_T("T_ORM_TEST"), false, true);
+        cursor->prepare(_T("SELECT ID, A FROM T_ORM_TEST WHERE ID >= ? ORDER BY ID"));
+        cursor->exec(Values(1, Value(id)));
+        RowsPtr rows = cursor->fetch_rows();
+        CPPUNIT_ASSERT_EQUAL((size_t)3, rows->size());
+        CPPUNIT_ASSERT_EQUAL(id + 2, (*rows)[2][0].second.as_longint());
+        CPPUNIT_ASSERT((*rows)[1][1].second.is_null());
+        CPPUNIT_ASSERT_EQUAL(string("batch 2"),
+                NARROW((*rows)[2][1].second.as_string()));
+        conn.commit();
+    }
+
+    void test_exec_batch_error_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        Table t(_T("T_ORM_TEST"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 100, 0));
+        LongInt id = get_next_test_id(engine.get_conn());
+        // the third row has the key of the one inserted in setUp()
+        const int count = 4;
+        vector<Values> data(count);
+        RowsData rows;
+        for (int i = 0; i < count; ++i) {
+            data[i].push_back(Value(i == 2? record_id_: id + i));
+            data[i].push_back(Value(_T("dup")));
+            rows.push_back(&data[i]);
+        }
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), true, true);
+        bool failed = false;
+        try {
+            engine.update(t, rows);
+            engine.insert(t, rows, false);
+        }
+        catch (const BatchExecError &e) {
+            failed = true;
+            const vector<size_t> &failed_rows = e.failed_rows();
+            CPPUNIT_ASSERT(std::find(failed_rows.begin(), failed_rows.end(),
+                        (size_t)2) != failed_rows.end());
+        }
+        CPPUNIT_ASSERT(failed);
+        engine.rollback();
+    }
+
+    void test_blob_stream_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        Table t(_T("T_ORM_BLOB"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("DATA"), Value::BLOB, 0, Column::LAZY));
+        engine.touch();
+        engine.get_conn()->prepare(_T("INSERT INTO T_ORM_BLOB(ID) VALUES(?)"));
+        engine.get_conn()->exec(Values(1, Value(record_id_)));
+        Key key = t.mk_key(record_id_);
+        ostringstream null_out;
+        CPPUNIT_ASSERT(!engine.read_blob(t, _T("DATA"), key, null_out));
+        // a few whole chunks and a tail
+        string data;
+        for (int i = 0; i < 3 * YB_BLOB_CHUNK_SIZE + 100; ++i)
+            data += (char)(i % 251);
+        istringstream in(data);
+        engine.write_blob(t, _T("DATA"), key, in, data.size());
+        ostringstream out;
+        CPPUNIT_ASSERT(engine.read_blob(t, _T("DATA"), key, out));
+        CPPUNIT_ASSERT_EQUAL(data.size(), out.str().size());
+        CPPUNIT_ASSERT(data == out.str());
+        // a short stream leaves the value and the connection intact
+        istringstream short_in(data.substr(0, 1000));
+        bool short_stream = false;
+        try {
+            engine.write_blob(t, _T("DATA"), key, short_in, data.size());
+        }
+        catch (const ShortBlobStream &) {
+            short_stream = true;
+        }
+        CPPUNIT_ASSERT(short_stream);
+        CPPUNIT_ASSERT(!engine.get_conn()->bad());
+        ostringstream out2;
+        CPPUNIT_ASSERT(engine.read_blob(t, _T("DATA"), key, out2));
+        CPPUNIT_ASSERT(data == out2.str());
+        bool not_found = false;
+        try {
+            engine.read_blob(t, _T("DATA"), t.mk_key(record_id_ + 1), out);
+        }
+        catch (const NoDataFound &) {
+            not_found = true;
+        }
+        CPPUNIT_ASSERT(not_found);
+        engine.rollback();
+    }
+
     void test_select_sql_max_rows()
     {
         Engine engine(Engine::READ_ONLY);
@@ -517,6 +897,157 @@ public:
         engine.commit();
     }
 
+    void test_insert_many_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        engine.get_conn()->set_echo(false);
+        Table t(_T("T_ORM_TEST"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 100, 0));
+        t.add_column(Column(_T("C"), Value::DECIMAL, 0, 0));
+        // More rows than fit into a single statement
+        const int count = 1200;
+        LongInt id = get_next_test_id(engine.get_conn());
+        vector<Values> data(count);
+        RowsData rows;
+        for (int i = 0; i < count; ++i) {
+            data[i].push_back(Value(id + i));
+            data[i].push_back(Value(_T("many")));
+            data[i].push_back(Value(Decimal(i)));
+            rows.push_back(&data[i]);
+        }
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), true, true);
+        engine.insert(t, rows, false);
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), false, true);
+        Value n = engine.select1(Expression(_T("COUNT(*)")),
+                ColumnExpr(t.name()), t.column(_T("A")) == Value(_T("many")));
+        CPPUNIT_ASSERT_EQUAL((LongInt)count, n.as_longint());
+        RowsPtr ptr = engine.select(Expression(_T("*")),
+                ColumnExpr(t.name()), t.column(_T("ID")) == id + count - 1);
+        CPPUNIT_ASSERT_EQUAL(1, (int)ptr->size());
+        CPPUNIT_ASSERT(Decimal(count - 1) ==
+                find_in_row(*ptr->begin(), _T("C"))->second.as_decimal());
+        engine.commit();
+    }
+
+    void test_delete_many_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        engine.get_conn()->set_echo(false);
+        Table t(_T("T_ORM_TEST"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 100, 0));
+        // More keys than fit into a single IN-list
+        const int count = 1200;
+        LongInt id = get_next_test_id(engine.get_conn());
+        vector<Values> data(count);
+        RowsData rows;
+        Keys keys;
+        for (int i = 0; i < count; ++i) {
+            data[i].push_back(Value(id + i));
+            data[i].push_back(Value(_T("del")));
+            rows.push_back(&data[i]);
+            keys.push_back(t.mk_key(id + i));
+        }
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), true, true);
+        engine.insert(t, rows, false);
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), false, true);
+        keys.pop_back();
+        engine.delete_from(t, keys);
+        Value n = engine.select1(Expression(_T("COUNT(*)")),
+                ColumnExpr(t.name()), t.column(_T("A")) == Value(_T("del")));
+        CPPUNIT_ASSERT_EQUAL((LongInt)1, n.as_longint());
+        engine.commit();
+    }
+
+    void test_fetch_many_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        engine.get_conn()->set_echo(false);
+        Table t(_T("T_ORM_TEST"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 100, 0));
+        t.add_column(Column(_T("C"), Value::DECIMAL, 0, 0));
+        // Several blocks of rows for a driver fetching them by blocks
+        const int count = 250;
+        LongInt id = get_next_test_id(engine.get_conn());
+        vector<Values> data(count);
+        RowsData rows;
+        for (int i = 0; i < count; ++i) {
+            data[i].push_back(Value(id + i));
+            data[i].push_back(i % 7? Value(_T("f") + to_string(i)): Value());
+            data[i].push_back(Value(Decimal(i) / Decimal(4)));
+            rows.push_back(&data[i]);
+        }
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), true, true);
+        engine.insert(t, rows, false);
+        engine.get_conn()->grant_insert_id(_T("T_ORM_TEST"), false, true);
+        SqlResultSet rs = engine.select_iter(
+                SelectExpr(ExpressionList(t.column(_T("ID")),
+                        t.column(_T("A")), t.column(_T("C"))))
+                .from_(ColumnExpr(t.name()))
+                .where_(t.column(_T("ID")) >= id)
+                .order_by_(t.column(_T("ID"))));
+        Values values;
+        int n = 0;
+        for (; rs.fetch_values(values); ++n) {
+            CPPUNIT_ASSERT(n < count);
+            CPPUNIT_ASSERT_EQUAL(id + n, values[0].as_longint());
+            CPPUNIT_ASSERT_EQUAL(data[n][1].is_null(), values[1].is_null());
+            if (!values[1].is_null())
+                CPPUNIT_ASSERT_EQUAL(NARROW(data[n][1].as_string()),
+                                     NARROW(values[1].as_string()));
+            CPPUNIT_ASSERT(data[n][2].as_decimal() == values[2].as_decimal());
+        }
+        CPPUNIT_ASSERT_EQUAL(count, n);
+        engine.commit();
+    }
+
+    void test_insert_new_ids_sql()
+    {
+        Engine engine(Engine::READ_WRITE);
+        setup_log(engine);
+        SqlDialect *dialect = engine.get_dialect();
+        bool sql_seq = dialect->has_sequences();
+        if (sql_seq) {
+            if (dialect->returning_model() == RETURNING_NONE)
+                return;
+            // The test table takes its keys from a sequence,
+            // give them a default until the rollback
+            engine.get_conn()->exec_direct(
+                    _T("ALTER TABLE T_ORM_TEST ALTER COLUMN ID SET DEFAULT ")
+                    + dialect->select_next_value(_T("S_ORM_TEST_ID")));
+        }
+        Table t(_T("T_ORM_TEST"));
+        t.add_column(Column(_T("ID"), Value::LONGINT, 0, Column::PK));
+        t.add_column(Column(_T("A"), Value::STRING, 100, 0));
+        t.set_autoinc(true);
+        const int count = 3;
+        vector<Values> data(count);
+        RowsData rows;
+        for (int i = 0; i < count; ++i) {
+            data[i].push_back(Value());
+            data[i].push_back(Value(_T("new id ") + to_string(i)));
+            rows.push_back(&data[i]);
+        }
+        vector<LongInt> ids = engine.insert(t, rows, true);
+        CPPUNIT_ASSERT_EQUAL((size_t)count, ids.size());
+        for (int i = 0; i < count; ++i) {
+            RowsPtr ptr = engine.select(Expression(_T("*")),
+                    ColumnExpr(t.name()), t.column(_T("ID")) == ids[i]);
+            CPPUNIT_ASSERT_EQUAL(1, (int)ptr->size());
+            CPPUNIT_ASSERT_EQUAL(string("new id ") + NARROW(to_string(i)),
+                    NARROW(find_in_row(*ptr->begin(), _T("A"))->second.as_string()));
+        }
+        if (sql_seq)
+            engine.rollback();
+        else
+            engine.commit();
+    }
+
     void test_update_sql()
     {
         Engine engine(Engine::READ_WRITE);
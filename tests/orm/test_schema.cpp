@@ -15,6 +15,7 @@ class TestMetaData : public CppUnit::TestFixture
     CPPUNIT_TEST(test_table_cons);
     CPPUNIT_TEST(test_table_columns);
     CPPUNIT_TEST(test_table_seq);
+    CPPUNIT_TEST(test_table_dml_plans);
     CPPUNIT_TEST(test_table_surrogate_pk);
     CPPUNIT_TEST(test_rel_join_cond);
     CPPUNIT_TEST(test_get_fk_for);
@@ -101,6 +102,24 @@ public:
         CPPUNIT_ASSERT_EQUAL(string("s_a_id"), NARROW(t.seq_name()));
     }
 
+    void test_table_dml_plans()
+    {
+        Table t(_T("A"));
+        t.add_column(Column(_T("X"), Value::LONGINT, 0, Column::PK));
+        CPPUNIT_ASSERT(!t.find_dml_plan(_T("K")));
+        DmlPlan plan;
+        plan.sql = _T("DELETE FROM A WHERE X = ?");
+        t.add_dml_plan(_T("K"), plan);
+        CPPUNIT_ASSERT_EQUAL(NARROW(plan.sql),
+                NARROW(t.find_dml_plan(_T("K"))->sql));
+        for (int i = 1; i < YB_MAX_DML_PLANS; ++i)
+            CPPUNIT_ASSERT(t.add_dml_plan(to_string(i), plan));
+        CPPUNIT_ASSERT(!t.add_dml_plan(_T("L"), plan));
+        // the plans depend on the columns
+        t.add_column(Column(_T("Y"), Value::LONGINT, 0, 0));
+        CPPUNIT_ASSERT(!t.find_dml_plan(_T("K")));
+    }
+
     void test_table_surrogate_pk()
     {
         Table t(_T("A"));
@@ -25,6 +25,7 @@ class TestXMLConfig : public CppUnit::TestFixture
     CPPUNIT_TEST(testParseTable);
     CPPUNIT_TEST(testNoAutoInc);
     CPPUNIT_TEST(testAutoInc);
+    CPPUNIT_TEST(testIdGenerator);
     CPPUNIT_TEST(testNullable);
     CPPUNIT_TEST(testClassName);
     CPPUNIT_TEST(testClassNameDefault);
@@ -135,6 +136,20 @@ public:
         CPPUNIT_ASSERT_EQUAL(true, t->autoinc());
     }
 
+    void testIdGenerator()
+    {
+        ElementTree::ElementPtr node(ElementTree::parse(
+            "<table name='A' sequence='S_A' id-generator='hilo' id-block='50'>"
+            "<column type='longint' name='B'>"
+            "<primary-key/>"
+            "</column>"
+            "</table>"
+        ));
+        Table::Ptr t = cfg_.parse_table(node);
+        CPPUNIT_ASSERT_EQUAL(string("hilo"), NARROW(t->id_generator()));
+        CPPUNIT_ASSERT_EQUAL(50, t->id_block());
+    }
+
     void testNullable()
     {
         ElementTree::ElementPtr node(ElementTree::parse(
@@ -5,6 +5,7 @@
 
 #include "util/string_utils.h"
 #include "util/element_tree.h"
+#include "util/arena.h"
 
 using namespace std;
 using namespace Yb;
@@ -491,4 +492,50 @@ public:
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestElementTree);
 
+class TestArena: public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestArena);
+
+    CPPUNIT_TEST(testArenaAllocate);
+    CPPUNIT_TEST(testArenaNew);
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testArenaAllocate()
+    {
+        Arena arena(1024);
+        char *a = (char *)arena.allocate(10);
+        char *b = (char *)arena.allocate(20);
+        CPPUNIT_ASSERT_EQUAL((size_t)1, arena.block_count());
+        CPPUNIT_ASSERT(b >= a + 10);
+        arena.deallocate(a, 10);
+        CPPUNIT_ASSERT(a == arena.allocate(16));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, arena.reuse_count());
+        arena.allocate(1000);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, arena.block_count());
+        CPPUNIT_ASSERT((char *)arena.allocate(10) == b + 32);
+        CPPUNIT_ASSERT_EQUAL((size_t)5, arena.alloc_count());
+    }
+
+    void testArenaNew()
+    {
+        ArenaPtr arena(new Arena());
+        void *p = arena_new(100, arena.get());
+        void *q = arena_new(100, NULL);
+        arena = ArenaPtr();
+        // The chunk keeps the arena alive
+        arena_delete(p, 100);
+        arena_delete(q, 100);
+        arena = ArenaPtr(new Arena());
+        p = arena_new(100, arena.get());
+        arena_delete(p, 100);
+        CPPUNIT_ASSERT(p == arena_new(100, arena.get()));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, arena->reuse_count());
+        arena_delete(p, 100);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestArena);
+
 // vim:ts=4:sts=4:sw=4:et:
@@ -30,6 +30,7 @@ class TestResultSet: public CppUnit::TestFixture
     CPPUNIT_TEST(testCopy);
     CPPUNIT_TEST(testLimitedCopy2);
     CPPUNIT_TEST(testLimitedCopy0);
+    CPPUNIT_TEST(testLoad);
     CPPUNIT_TEST_EXCEPTION(testThrows, Yb::AssertError);
 
     CPPUNIT_TEST_SUITE_END();
@@ -89,6 +90,22 @@ public:
         CPPUNIT_ASSERT_EQUAL((size_t)0, out.size());
     }
 
+    void testLoad()
+    {
+        Items items(3);
+        items[0] = 10; items[1] = 11; items[2] = 12;
+        MockResultSet rs(items);
+        MockResultSet::iterator it = rs.begin(), end = rs.end();
+        CPPUNIT_ASSERT_EQUAL(12, *it);
+        rs.load();
+        items[0] = 0;
+        CPPUNIT_ASSERT_EQUAL(12, *it++);
+        CPPUNIT_ASSERT_EQUAL(11, *it++);
+        CPPUNIT_ASSERT_EQUAL(10, *it);
+        ++it;
+        CPPUNIT_ASSERT(it == end);
+    }
+
     void testThrows()
     {
         Items items;
@@ -24,6 +24,10 @@ class TestValue : public CppUnit::TestFixture
     CPPUNIT_TEST(test_as_float);
     CPPUNIT_TEST(test_swap);
     CPPUNIT_TEST(test_fix_type);
+    CPPUNIT_TEST(test_copy_shared);
+#if defined(YB_USE_RVALUE_REFS)
+    CPPUNIT_TEST(test_move);
+#endif
 #if defined(YB_USE_TUPLE)
     CPPUNIT_TEST(test_tuple_values);
 #endif
@@ -37,6 +41,7 @@ class TestValue : public CppUnit::TestFixture
     CPPUNIT_TEST_EXCEPTION(test_value_bad_cast_date_time, ValueBadCast);
     CPPUNIT_TEST(testEmptyKey);
     CPPUNIT_TEST(testKey2Str);
+    CPPUNIT_TEST(testKeyHash);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -209,6 +214,42 @@ public:
         CPPUNIT_ASSERT_EQUAL(12.3, b.read_as<double>());
     }
 
+    void test_copy_shared()
+    {
+        Value a(_T("12")), d(Decimal(_T("1.5"))), t(dt_make(2001, 2, 3));
+        Value b(a), e, u(t);
+        e = d;
+        // the copies of a string refer to the same buffer
+        CPPUNIT_ASSERT(&a.read_as<String>() == &b.read_as<String>());
+        b.fix_type(Value::INTEGER);
+        CPPUNIT_ASSERT_EQUAL(12, b.read_as<int>());
+        CPPUNIT_ASSERT(Value::STRING == a.get_type());
+        CPPUNIT_ASSERT_EQUAL(string("12"), NARROW(a.as_string()));
+        a = Value(1);
+        CPPUNIT_ASSERT_EQUAL(1, a.as_integer());
+        CPPUNIT_ASSERT(Decimal(_T("1.5")) == e.read_as<Decimal>());
+        CPPUNIT_ASSERT(dt_make(2001, 2, 3) == u.read_as<DateTime>());
+        u = e;
+        CPPUNIT_ASSERT(Value::DECIMAL == u.get_type());
+        Blob blob(3, 'x');
+        Value v(blob), w(v);
+        CPPUNIT_ASSERT(blob == w.read_as<Blob>());
+    }
+
+#if defined(YB_USE_RVALUE_REFS)
+    void test_move()
+    {
+        Value a(_T("moved")), d(Decimal(_T("2.5")));
+        const String *buf = &a.read_as<String>();
+        Value b(std::move(a));
+        CPPUNIT_ASSERT(a.is_null());
+        CPPUNIT_ASSERT(buf == &b.read_as<String>());
+        a = std::move(d);
+        CPPUNIT_ASSERT(d.is_null());
+        CPPUNIT_ASSERT(Decimal(_T("2.5")) == a.read_as<Decimal>());
+    }
+#endif
+
 #if defined(YB_USE_TUPLE)
     void test_tuple_values()
     {
@@ -307,6 +348,27 @@ public:
         k5.fields.push_back(std::make_pair(&col_a, Value(10)));
         CPPUNIT_ASSERT_EQUAL(string("Key('TBL1', {'A': 10})"), NARROW(key2str(k5)));
     }
+
+    void testKeyHash()
+    {
+        String tbl_name = _T("TBL1"), tbl_name2 = _T("TBL1"), col_a = _T("A");
+        Key k1(&tbl_name, &col_a, 10, false), k2(&tbl_name2, &col_a, 10, false);
+        CPPUNIT_ASSERT(key_hash(k1) != 0);
+        CPPUNIT_ASSERT_EQUAL(key_hash(k1), key_hash(k2));
+        CPPUNIT_ASSERT_EQUAL(key_hash(k1), k1.hash_value);
+        k2.reset(&tbl_name2, &col_a, 11, false);
+        CPPUNIT_ASSERT_EQUAL((size_t)0, k2.hash_value);
+        CPPUNIT_ASSERT(key_hash(k1) != key_hash(k2));
+        Key k3(&tbl_name), k4(&tbl_name);
+        k3.fields.push_back(std::make_pair(&col_a, Value(20)));
+        k4.fields.push_back(std::make_pair(&col_a, Value((LongInt)20)));
+        CPPUNIT_ASSERT(k3 == k4);
+        CPPUNIT_ASSERT_EQUAL(key_hash(k3), key_hash(k4));
+        // A zero hash would be taken for "not computed yet"
+        Key k5;
+        CPPUNIT_ASSERT_EQUAL((size_t)1, key_hash(k5));
+        CPPUNIT_ASSERT_EQUAL((size_t)1, k5.hash_value);
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestValue);